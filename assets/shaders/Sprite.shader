@@ -1,21 +1,38 @@
 #ifdef VERTEX
 attribute vec4 aPosition;
 attribute vec2 aTexture;
+attribute vec4 aColor;
 varying vec2 vTexture;
+varying vec4 vColor;
+#ifdef TEXTURE_SLOTS
+attribute float aSlot;
+varying float vSlot;
+#endif
 uniform mat4 uProjection;
 void main() {
    vTexture = aTexture;
+   vColor = aColor;
+#ifdef TEXTURE_SLOTS
+   vSlot = aSlot;
+#endif
    gl_Position = uProjection * aPosition;
 }
 #endif
 #ifdef FRAGMENT
 precision mediump float;
-uniform sampler2D uTexture;
-uniform vec3 uColor;
-uniform float uOpaque;
 varying vec2 vTexture;
+varying vec4 vColor;
+#ifdef TEXTURE_SLOTS
+// SAMPLE_SLOT is generated for the number of texture slots.
+uniform sampler2D uTexture[TEXTURE_SLOTS];
+varying float vSlot;
 void main() {
-    vec4 color = vec4(uColor.x, uColor.y, uColor.z, uOpaque);
-    gl_FragColor = texture2D(uTexture, vTexture) * color;
+    gl_FragColor = SAMPLE_SLOT(vTexture) * vColor;
 }
+#else
+uniform sampler2D uTexture;
+void main() {
+    gl_FragColor = texture2D(uTexture, vTexture) * vColor;
+}
+#endif
 #endif
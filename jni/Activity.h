@@ -77,6 +77,9 @@ protected:
         paused = false;
         if (scene != NULL) scene->resume();
     };
+    bool isIdle() {
+        return !sceneChanged && (scene == NULL || paused || scene->isIdle());
+    };
     void onDeactivate() {
         LOG_INFO("Deactivating Engine.");
     };
@@ -0,0 +1,60 @@
+#ifndef __ATLASMANIFEST_H__
+#define __ATLASMANIFEST_H__
+
+/* Binary atlas manifest, written by tools/atlas */
+
+#include <stdint.h>
+
+// Manifest layout: header, pages, sheets sorted by name hash, frames.
+// Rectangles are bottom-up, the same way textures are uploaded.
+const uint32_t ATLAS_MANIFEST_MAGIC = 0x4C54414C; // "LATL"
+const uint32_t ATLAS_MANIFEST_VERSION = 2;
+const int ATLAS_PATH_SIZE = 64;
+// Frame flags: no pixel of the trimmed frame is transparent.
+const uint16_t ATLAS_FRAME_SOLID = 1;
+
+struct AtlasManifestHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pageCount;
+    uint32_t sheetCount;
+    uint32_t frameCount;
+};
+
+struct AtlasPage {
+    char path[ATLAS_PATH_SIZE];
+    uint16_t width, height;
+};
+
+// Sprite sheet, all of its frames are on the same page.
+struct AtlasSheet {
+    uint32_t nameHash;
+    uint16_t page;
+    uint16_t frameCount;
+    uint32_t firstFrame;
+    // Full path, verifies the hash match.
+    char name[ATLAS_PATH_SIZE];
+};
+
+struct AtlasFrame {
+    // Trimmed image on the page.
+    uint16_t x, y, width, height;
+    // Trimmed image position inside of the source frame.
+    int16_t offsetX, offsetY;
+    uint16_t sourceWidth, sourceHeight;
+    // Pivot relative to the source frame center.
+    int16_t pivotX, pivotY;
+    uint16_t flags;
+};
+
+// FNV-1a hash of the image path.
+inline uint32_t atlasNameHash(const char* name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+};
+
+#endif // __ATLASMANIFEST_H__
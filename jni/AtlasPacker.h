@@ -0,0 +1,86 @@
+#ifndef __ATLASPACKER_H__
+#define __ATLASPACKER_H__
+
+/* Skyline bottom-left rectangle packer */
+
+#include <vector>
+
+class AtlasPacker {
+public:
+    AtlasPacker(int width, int height):
+        width(width), height(height),
+        skyline() {
+        reset();
+    };
+    void reset() {
+        Node node = { 0, 0, width };
+        skyline.clear();
+        skyline.push_back(node);
+    };
+    int getWidth() {
+        return width;
+    };
+    int getHeight() {
+        return height;
+    };
+    // Finds a place for the rectangle, returns false if page is full.
+    bool insert(int rectWidth, int rectHeight, int& x, int& y) {
+        int bestIndex = -1, bestY = height, bestWidth = width;
+        for (int i = 0; i < (int)skyline.size(); ++i) {
+            int top;
+            if (!fit(i, rectWidth, rectHeight, top)) continue;
+            // Prefers lowest position, then the tightest skyline segment.
+            if (top < bestY || (top == bestY && skyline[i].width < bestWidth)) {
+                bestIndex = i;
+                bestY = top;
+                bestWidth = skyline[i].width;
+            }
+        }
+        if (bestIndex < 0) return false;
+        x = skyline[bestIndex].x;
+        y = bestY;
+        // Raises the skyline under the new rectangle.
+        Node node = { x, y + rectHeight, rectWidth };
+        skyline.insert(skyline.begin() + bestIndex, node);
+        for (int i = bestIndex + 1; i < (int)skyline.size(); ++i) {
+            int previousEnd = skyline[i-1].x + skyline[i-1].width;
+            if (skyline[i].x >= previousEnd) break;
+            int shrink = previousEnd - skyline[i].x;
+            skyline[i].x += shrink;
+            skyline[i].width -= shrink;
+            if (skyline[i].width > 0) break;
+            skyline.erase(skyline.begin() + i);
+            --i;
+        }
+        // Merges neighbour segments at the same level.
+        for (int i = 0; i < (int)skyline.size() - 1; ++i) {
+            if (skyline[i].y == skyline[i+1].y) {
+                skyline[i].width += skyline[i+1].width;
+                skyline.erase(skyline.begin() + i + 1);
+                --i;
+            }
+        }
+        return true;
+    };
+private:
+    struct Node {
+        int x, y, width;
+    };
+    // Tests if rectangle fits on the skyline starting at given segment.
+    bool fit(int index, int rectWidth, int rectHeight, int& top) {
+        if (skyline[index].x + rectWidth > width) return false;
+        int remaining = rectWidth;
+        top = 0;
+        while (remaining > 0 && index < (int)skyline.size()) {
+            if (skyline[index].y > top) top = skyline[index].y;
+            if (top + rectHeight > height) return false;
+            remaining -= skyline[index].width;
+            ++index;
+        }
+        return remaining <= 0;
+    };
+    int width, height;
+    std::vector<Node> skyline;
+};
+
+#endif // __ATLASPACKER_H__
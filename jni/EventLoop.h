@@ -6,6 +6,10 @@
 #include <android/input.h>
 #include <android/sensor.h>
 
+// Milliseconds the idle loop waits for events, game timers are checked
+// at this pace.
+const int IDLE_POLL_TIMEOUT = 100;
+
 void showUI() {
     JNIEnv *jni;
     application->activity->vm->AttachCurrentThread(&jni, NULL);
@@ -42,6 +46,8 @@ public:
     virtual void onDestroyWindow() {};
     virtual void onGainFocus() {};
     virtual void onLostFocus() {};
+    // Returns false while the application animates apart from tweens.
+    virtual bool isIdle() { return true; };
 };
 
 class EventLoop {
@@ -49,6 +55,7 @@ public:
     EventLoop():
         enabled(false),
         quit(false),
+        idle(false),
         activityHandler(NULL),
         sensorPollSource(),
         sensorManager(NULL),
@@ -61,6 +68,9 @@ public:
         TimeManager::getInstance();
         InputManager::getInstance();
         GraphicsManager::getInstance();
+        // Shared by texture decoding threads.
+        PixelBufferPool::getInstance();
+        TextureCache::initialize();
         SoundManager::getInstance();
         TweenManager::getInstance();
     };
@@ -70,8 +80,10 @@ public:
         TweenManager::dispose();
         SoundManager::dispose();
         GraphicsManager::dispose();
+        PixelBufferPool::dispose();
         InputManager::dispose();
         TimeManager::dispose();
+        GLState::dispose();
     };
     void run(ActivityHandler* activity) {
         int32_t result;
@@ -81,8 +93,9 @@ public:
         activityHandler = activity;
         LOG_INFO("Starting event loop.");
         while (true) {
-            // Event processing loop.
-            while ((result = ALooper_pollAll(enabled ? 0 : -1, NULL, &events, (void**) &source)) >= 0) {
+            // Event processing loop. Idle loop sleeps until an event comes
+            // or the timeout expires, events wake it up for the next step.
+            while ((result = ALooper_pollAll(enabled ? (idle ? IDLE_POLL_TIMEOUT : 0) : -1, NULL, &events, (void**) &source)) >= 0) {
                 // An event has to be processed.
                 if (source != NULL) source->process(application, source);
                 // Application is getting destroyed.
@@ -108,9 +121,15 @@ protected:
         if (GraphicsManager::getInstance()->update() != STATUS_OK) return STATUS_ERROR;
         if (TweenManager::getInstance()->update() != STATUS_OK) return STATUS_ERROR;
         if (activityHandler->onStep() != STATUS_OK) return STATUS_ERROR;
+        // Nothing moves and the shown frame is up to date.
+        idle = InputManager::getInstance()->isIdle() && TweenManager::getInstance()->isIdle()
+            && activityHandler->isIdle() && !GraphicsManager::getInstance()->hasChanges();
 #ifdef FPS_COUNTER
         updateFPS(TimeManager::getInstance()->getFrameRate());
 #endif // FPS_COUNTER
+#ifdef RENDER_STATS
+        GraphicsManager::getInstance()->logRenderStats();
+#endif // RENDER_STATS
         return STATUS_OK;
     };
     void activate() {
@@ -167,6 +186,7 @@ ERROR:
         }
     };
     void processAppEvent(int32_t command) {
+        idle = false;
         switch (command) {
         case APP_CMD_CONFIG_CHANGED:
             LOG_DEBUG("[onConfigurationChanged]");
@@ -217,6 +237,10 @@ ERROR:
             LOG_DEBUG("[onStop]");
             activityHandler->onStop();
             break;
+        case APP_CMD_WINDOW_REDRAW_NEEDED:
+            LOG_DEBUG("[onWindowRedrawNeeded]");
+            GraphicsManager::getInstance()->markDamaged();
+            break;
         case APP_CMD_TERM_WINDOW:
             LOG_DEBUG("[onDestroyWindow]");
             activityHandler->onDestroyWindow();
@@ -226,6 +250,7 @@ ERROR:
         }
     };
     int32_t processInputEvent(AInputEvent* event) {
+        idle = false;
         int32_t eventType = AInputEvent_getType(event);
         switch (eventType) {
         case AINPUT_EVENT_TYPE_MOTION:
@@ -246,6 +271,7 @@ ERROR:
     };
 #ifdef INPUTMANAGER_SENSORS_EVENTS
     void processSensorEvent() {
+        idle = false;
         if (sensorEventQueue != NULL) {
             ASensorEvent event;
             while (ASensorEventQueue_getEvents(sensorEventQueue, &event, 1) > 0) {
@@ -311,6 +337,8 @@ private:
     bool enabled;
     // Indicates if the event handler wants to exit.
     bool quit;
+    // Set when the last step changed nothing, the loop then waits for events.
+    bool idle;
     // Activity event observer.
     ActivityHandler* activityHandler;
     // Sensors
@@ -0,0 +1,254 @@
+#ifndef __FLIPBOOK_H__
+#define __FLIPBOOK_H__
+
+/* Streams animation frames into a small ring of textures */
+
+#include <png.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GLState.h"
+#include "Resource.h"
+#include "FlipbookFormat.h"
+
+// Textures holding decoded frames, the shown one and the next ones.
+const int FLIPBOOK_RING_SIZE = 4;
+const int FLIPBOOK_LOOKAHEAD = FLIPBOOK_RING_SIZE - 1;
+
+// Frames are decoded on a thread of their own, ahead of the frame shown,
+// and uploaded when ready. Only one playback of a flipbook is streamed.
+class Flipbook {
+public:
+    Flipbook(const std::string& path):
+        path(path), resource(this->path.c_str()),
+        data(NULL), header(NULL), offsets(NULL),
+        slots(), shownSlot(0), buffers(),
+        decoder(), mutex(), condition(),
+        requests(), pending(), decoded(), freeBuffers(), brokenFrames(), quit(false) {
+        //
+    };
+    ~Flipbook() {
+        unload();
+    };
+    status load() {
+        data = (const uint8_t*) resource.map();
+        if (data == NULL) return STATUS_ERROR;
+        LOG_INFO("Loading flipbook: %s", resource.getPath());
+        off_t length = resource.getLength();
+        header = (const FlipbookHeader*) data;
+        offsets = (const uint32_t*) (data + sizeof(FlipbookHeader));
+        if (length < (off_t)sizeof(FlipbookHeader) || header->magic != FLIPBOOK_MAGIC || header->version != FLIPBOOK_VERSION
+                || header->frameCount == 0 || header->frameWidth == 0 || header->frameHeight == 0
+                || length < (off_t)(sizeof(FlipbookHeader) + (header->frameCount + 1) * sizeof(uint32_t))) goto ERROR;
+        for (uint32_t i = 0; i < header->frameCount; ++i) {
+            if (offsets[i] > offsets[i + 1] || offsets[i + 1] > (uint32_t)length) goto ERROR;
+        }
+        // Creates the ring, its decode buffers are reused.
+        for (int i = 0; i < FLIPBOOK_RING_SIZE; ++i) {
+            glGenTextures(1, &slots[i].textureId);
+            GLState::getInstance()->bindTexture(0, slots[i].textureId);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, header->frameWidth, header->frameHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            slots[i].frame = -1;
+            buffers[i].resize(header->frameWidth * header->frameHeight * 4);
+            freeBuffers.push_back(i);
+        }
+        if (glGetError() != GL_NO_ERROR) goto ERROR;
+        // First frame is decoded at once, so there is always one to show.
+        if (!decode(0, &buffers[0][0])) goto ERROR;
+        upload(0, 0, &buffers[0][0]);
+        shownSlot = 0;
+        decoder = std::thread(&Flipbook::run, this);
+        LOG_DEBUG("Flipbook of %d frames, %d x %d.", header->frameCount, header->frameWidth, header->frameHeight);
+        return STATUS_OK;
+ERROR:
+        LOG_ERROR("Error while loading flipbook");
+        unload();
+        return STATUS_ERROR;
+    };
+    // Stops decoding and releases textures, needs the OpenGL context.
+    void unload() {
+        if (decoder.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                quit = true;
+            }
+            condition.notify_all();
+            decoder.join();
+        }
+        for (int i = 0; i < FLIPBOOK_RING_SIZE; ++i) {
+            if (slots[i].textureId != 0) GLState::getInstance()->deleteTexture(slots[i].textureId);
+            slots[i].textureId = 0;
+            buffers[i].clear();
+        }
+        requests.clear();
+        pending.clear();
+        decoded.clear();
+        freeBuffers.clear();
+        brokenFrames.clear();
+        quit = false;
+        resource.close();
+        data = NULL;
+        header = NULL;
+    };
+    int getFrameCount() {
+        return header->frameCount;
+    };
+    int getFrameWidth() {
+        return header->frameWidth;
+    };
+    int getFrameHeight() {
+        return header->frameHeight;
+    };
+    bool isSolid() {
+        return (header->flags & FLIPBOOK_SOLID) != 0;
+    };
+    // True while the frame is not shown yet. Broken frames are never
+    // shown, the last one stays instead.
+    bool isPending(int frame) {
+        return frame >= 0 && frame < (int)header->frameCount && slots[shownSlot].frame != frame
+            && std::find(brokenFrames.begin(), brokenFrames.end(), frame) == brokenFrames.end();
+    };
+    // Uploads decoded frames, requests the next ones and returns the
+    // texture of the frame, or of the last one shown while it is decoded.
+    GLuint update(int frame) {
+        std::vector<DecodedFrame> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(decoded);
+        }
+        for (std::vector<DecodedFrame>::iterator it = ready.begin(); it < ready.end(); ++it) {
+            if (it->buffer < 0) {
+                brokenFrames.push_back(it->frame);
+                continue;
+            }
+            // Frames left behind by playback are dropped.
+            int slot = inWindow(it->frame, frame) ? findFreeSlot(frame) : -1;
+            if (slot >= 0) upload(slot, it->frame, &buffers[it->buffer][0]);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::vector<DecodedFrame>::iterator it = ready.begin(); it < ready.end(); ++it) {
+                if (it->buffer >= 0) freeBuffers.push_back(it->buffer);
+                pending.erase(std::find(pending.begin(), pending.end(), it->frame));
+            }
+            // Requests frames from the shown one, older requests are dropped.
+            for (std::deque<int>::iterator it = requests.begin(); it != requests.end();) {
+                if (inWindow(*it, frame)) {
+                    ++it;
+                    continue;
+                }
+                pending.erase(std::find(pending.begin(), pending.end(), *it));
+                it = requests.erase(it);
+            }
+            for (int next = std::max(frame, 0); next < frame + FLIPBOOK_LOOKAHEAD && next < (int)header->frameCount; ++next) {
+                if (findSlot(next) >= 0 || std::find(pending.begin(), pending.end(), next) != pending.end()
+                        || std::find(brokenFrames.begin(), brokenFrames.end(), next) != brokenFrames.end()) continue;
+                requests.push_back(next);
+                pending.push_back(next);
+            }
+        }
+        condition.notify_one();
+        int slot = findSlot(frame);
+        if (slot >= 0) shownSlot = slot;
+        return slots[shownSlot].textureId;
+    };
+private:
+    struct FlipbookSlot {
+        GLuint textureId;
+        int frame;
+    };
+    struct DecodedFrame {
+        int frame;
+        // Buffer holding the pixels, -1 when the frame is broken.
+        int buffer;
+    };
+    // Decodes requested frames while buffers are free.
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            condition.wait(lock, [this] { return quit || (!requests.empty() && !freeBuffers.empty()); });
+            if (quit) return;
+            int frame = requests.front();
+            requests.pop_front();
+            int buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+            lock.unlock();
+            bool result = decode(frame, &buffers[buffer][0]);
+            lock.lock();
+            // Broken frame is reported without buffer, it is not requested
+            // again and the last one stays.
+            DecodedFrame decodedFrame = { frame, result ? buffer : -1 };
+            decoded.push_back(decodedFrame);
+            if (!result) freeBuffers.push_back(buffer);
+        }
+    };
+    // Decodes the frame bottom-up, as textures are uploaded.
+    bool decode(int frame, uint8_t* pixels) {
+        png_image image;
+        memset(&image, 0, sizeof(image));
+        image.version = PNG_IMAGE_VERSION;
+        if (!png_image_begin_read_from_memory(&image, data + offsets[frame], offsets[frame + 1] - offsets[frame])) goto ERROR;
+        image.format = PNG_FORMAT_RGBA;
+        if (image.width != header->frameWidth || image.height != header->frameHeight) goto ERROR;
+        if (!png_image_finish_read(&image, NULL, pixels, -(png_int_32)PNG_IMAGE_ROW_STRIDE(image), NULL)) goto ERROR;
+        return true;
+ERROR:
+        LOG_ERROR("Error while decoding flipbook frame %d: %s", frame, image.message);
+        png_image_free(&image);
+        return false;
+    };
+    void upload(int slot, int frame, const uint8_t* pixels) {
+        GLState::getInstance()->bindTexture(0, slots[slot].textureId);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, header->frameWidth, header->frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        slots[slot].frame = frame;
+    };
+    bool inWindow(int frame, int shown) {
+        return frame >= shown && frame < shown + FLIPBOOK_LOOKAHEAD;
+    };
+    int findSlot(int frame) {
+        for (int i = 0; i < FLIPBOOK_RING_SIZE; ++i) {
+            if (slots[i].frame == frame) return i;
+        }
+        return -1;
+    };
+    // Slot neither shown nor holding a frame ahead of the shown one.
+    int findFreeSlot(int shown) {
+        for (int i = 0; i < FLIPBOOK_RING_SIZE; ++i) {
+            if (i != shownSlot && !inWindow(slots[i].frame, shown)) return i;
+        }
+        return -1;
+    };
+    std::string path;
+    Resource resource;
+    // Mapped file.
+    const uint8_t* data;
+    const FlipbookHeader* header;
+    const uint32_t* offsets;
+    FlipbookSlot slots[FLIPBOOK_RING_SIZE];
+    int shownSlot;
+    std::vector<uint8_t> buffers[FLIPBOOK_RING_SIZE];
+    // Decoder thread and the queues it shares, guarded by the mutex.
+    std::thread decoder;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<int> requests;
+    // Frames requested, being decoded or decoded but not uploaded.
+    std::vector<int> pending;
+    std::vector<DecodedFrame> decoded;
+    std::vector<int> freeBuffers;
+    // Frames which failed to decode, only used by the main thread.
+    std::vector<int> brokenFrames;
+    bool quit;
+};
+
+#endif // __FLIPBOOK_H__
@@ -0,0 +1,26 @@
+#ifndef __FLIPBOOKFORMAT_H__
+#define __FLIPBOOKFORMAT_H__
+
+/* Flipbook of streamed animation frames, written by tools/flipbook */
+
+#include <stdint.h>
+
+// File layout: header, frameCount + 1 offsets from the file start, then
+// each frame as a PNG image. Frames follow the sprite sheet order, from
+// the top left frame row by row.
+const uint32_t FLIPBOOK_MAGIC = 0x424C464C; // "LFLB"
+const uint32_t FLIPBOOK_VERSION = 1;
+const char* const FLIPBOOK_EXTENSION = ".flb";
+// Flags: no pixel of any frame is transparent.
+const uint32_t FLIPBOOK_SOLID = 1;
+
+struct FlipbookHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t frameWidth;
+    uint32_t frameHeight;
+    uint32_t flags;
+};
+
+#endif // __FLIPBOOKFORMAT_H__
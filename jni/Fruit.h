@@ -74,7 +74,7 @@ public:
         if (animated && !selected) {
             if (xScaleTween != NULL) TweenManager::getInstance()->remove(xScaleTween);
             if (yScaleTween != NULL) TweenManager::getInstance()->remove(yScaleTween);
-            sprite->scale = Vector2(0.9f, 0.9f);
+            sprite->setScale(Vector2(0.9f, 0.9f));
             animated = false;
         }
     };
@@ -0,0 +1,178 @@
+#ifndef __GLSTATE_H__
+#define __GLSTATE_H__
+
+/* Tracks OpenGL state and skips calls which would not change it */
+
+#include <GLES2/gl2.h>
+
+#include "Singleton.h"
+
+const int MAX_TEXTURE_UNITS = 8;
+
+class GLState: public Singleton<GLState> {
+public:
+    GLState():
+        program(0), blend(0), blendFactors(),
+        depthTest(0), depthMask(0), scissorTest(0), scissorRect(),
+        activeUnit(0), textures(), arrayBuffer(0), elementBuffer(0),
+        vertexAttribArrays(0), framebuffer(0), viewportRect(),
+        redundantCalls(0) {
+        invalidate();
+    };
+    // Forgets cached state, so the next calls reach OpenGL. Needed when
+    // a context is created or state was changed bypassing the cache.
+    void invalidate() {
+        program = UNKNOWN;
+        blend = -1;
+        for (int i = 0; i < 4; ++i) blendFactors[i] = UNKNOWN;
+        depthTest = depthMask = scissorTest = -1;
+        scissorRect[2] = -1;
+        activeUnit = UNKNOWN;
+        for (int i = 0; i < MAX_TEXTURE_UNITS; ++i) textures[i] = UNKNOWN;
+        arrayBuffer = elementBuffer = UNKNOWN;
+        vertexAttribArrays = UNKNOWN;
+        framebuffer = UNKNOWN;
+        viewportRect[2] = -1;
+    };
+    void useProgram(GLuint id) {
+        if (id == program) { redundantCalls++; return; }
+        program = id;
+        glUseProgram(id);
+    };
+    void setBlend(bool enabled) {
+        if ((int)enabled == blend) { redundantCalls++; return; }
+        blend = enabled;
+        if (enabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    };
+    // Alpha has its own factors, so that targets with an alpha channel
+    // keep the coverage of what is drawn into them.
+    void blendFuncSeparate(GLenum sourceColor, GLenum destinationColor, GLenum sourceAlpha, GLenum destinationAlpha) {
+        if (sourceColor == blendFactors[0] && destinationColor == blendFactors[1]
+                && sourceAlpha == blendFactors[2] && destinationAlpha == blendFactors[3]) {
+            redundantCalls++;
+            return;
+        }
+        blendFactors[0] = sourceColor; blendFactors[1] = destinationColor;
+        blendFactors[2] = sourceAlpha; blendFactors[3] = destinationAlpha;
+        glBlendFuncSeparate(sourceColor, destinationColor, sourceAlpha, destinationAlpha);
+    };
+    void setDepthTest(bool enabled) {
+        if ((int)enabled == depthTest) { redundantCalls++; return; }
+        depthTest = enabled;
+        if (enabled) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+    };
+    void setDepthMask(bool enabled) {
+        if ((int)enabled == depthMask) { redundantCalls++; return; }
+        depthMask = enabled;
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    };
+    void setScissorTest(bool enabled) {
+        if ((int)enabled == scissorTest) { redundantCalls++; return; }
+        scissorTest = enabled;
+        if (enabled) glEnable(GL_SCISSOR_TEST); else glDisable(GL_SCISSOR_TEST);
+    };
+    void scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+        if (scissorRect[0] == x && scissorRect[1] == y && scissorRect[2] == width && scissorRect[3] == height) {
+            redundantCalls++;
+            return;
+        }
+        scissorRect[0] = x; scissorRect[1] = y;
+        scissorRect[2] = width; scissorRect[3] = height;
+        glScissor(x, y, width, height);
+    };
+    // Binds 2D texture to a texture unit, the unit is only activated
+    // when its binding changes.
+    void bindTexture(int unit, GLuint id) {
+        if (textures[unit] == id) { redundantCalls++; return; }
+        if (activeUnit != (GLuint)unit) {
+            activeUnit = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        textures[unit] = id;
+        glBindTexture(GL_TEXTURE_2D, id);
+    };
+    void bindBuffer(GLenum target, GLuint id) {
+        GLuint& buffer = (target == GL_ELEMENT_ARRAY_BUFFER) ? elementBuffer : arrayBuffer;
+        if (buffer == id) { redundantCalls++; return; }
+        buffer = id;
+        glBindBuffer(target, id);
+    };
+    // Locations whose arrays are tracked, attributes stripped by the
+    // compiler or beyond the mask are not.
+    static bool isAttribLocationValid(GLint location) {
+        return location >= 0 && location < MAX_VERTEX_ATTRIBS;
+    };
+    // Enables attribute arrays whose location bit is set in mask and
+    // disables the others.
+    void setVertexAttribArrays(GLuint mask) {
+        if (mask == vertexAttribArrays) { redundantCalls++; return; }
+        for (int location = 0; location < MAX_VERTEX_ATTRIBS; ++location) {
+            GLuint bit = 1u << location;
+            if ((vertexAttribArrays & bit) == (mask & bit) && vertexAttribArrays != UNKNOWN) continue;
+            if (mask & bit) glEnableVertexAttribArray(location); else glDisableVertexAttribArray(location);
+        }
+        vertexAttribArrays = mask;
+    };
+    void bindFramebuffer(GLuint id) {
+        if (id == framebuffer) { redundantCalls++; return; }
+        framebuffer = id;
+        glBindFramebuffer(GL_FRAMEBUFFER, id);
+    };
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        if (viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == width && viewportRect[3] == height) {
+            redundantCalls++;
+            return;
+        }
+        viewportRect[0] = x; viewportRect[1] = y;
+        viewportRect[2] = width; viewportRect[3] = height;
+        glViewport(x, y, width, height);
+    };
+    // Deleted objects are unbound by OpenGL, the cache has to follow.
+    void deleteTexture(GLuint id) {
+        for (int i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+            if (textures[i] == id) textures[i] = 0;
+        }
+        glDeleteTextures(1, &id);
+    };
+    void deleteBuffers(int count, const GLuint* ids) {
+        for (int i = 0; i < count; ++i) {
+            if (arrayBuffer == ids[i]) arrayBuffer = 0;
+            if (elementBuffer == ids[i]) elementBuffer = 0;
+        }
+        glDeleteBuffers(count, ids);
+    };
+    void deleteFramebuffer(GLuint id) {
+        if (framebuffer == id) framebuffer = 0;
+        glDeleteFramebuffers(1, &id);
+    };
+    // A program in use is only deleted once it is not used anymore, so
+    // the cache forgets it.
+    void deleteProgram(GLuint id) {
+        if (program == id) program = UNKNOWN;
+        glDeleteProgram(id);
+    };
+    // Returns calls skipped since the last call and resets the counter.
+    int takeRedundantCalls() {
+        int count = redundantCalls;
+        redundantCalls = 0;
+        return count;
+    };
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFF;
+    static const int MAX_VERTEX_ATTRIBS = 8;
+    GLuint program;
+    int blend;
+    GLenum blendFactors[4];
+    int depthTest, depthMask;
+    int scissorTest;
+    GLint scissorRect[4];
+    GLuint activeUnit;
+    GLuint textures[MAX_TEXTURE_UNITS];
+    GLuint arrayBuffer, elementBuffer;
+    GLuint vertexAttribArrays;
+    GLuint framebuffer;
+    GLint viewportRect[4];
+    int redundantCalls;
+};
+
+#endif // __GLSTATE_H__
@@ -6,6 +6,12 @@
 #include <math.h>
 #include <stdlib.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #define EPSILON (1e-6)
 // float pi = 4.0f * atan(1.0f);
 #define PI (3.14159265358979323846)
@@ -815,4 +821,71 @@ public:
     inline Rect(float Left, float Top, float Right, float Bottom): left(Left), top(Top), right(Right), bottom(Bottom) {};
 };
 
+// ----------------------------------------------------------------------------
+// 2D affine transformation: scale, rotation around pivot and translation.
+// Sine and cosine are cached until the angle changes.
+// ----------------------------------------------------------------------------
+class Transform2D {
+public:
+    float a, b, c, d, tx, ty;
+
+    // Constructors.
+    inline Transform2D(void): a(1.0f), b(0.0f), c(0.0f), d(1.0f), tx(0.0f), ty(0.0f), angle(0.0f), cosAngle(1.0f), sinAngle(0.0f) {};
+
+    // Same as Translate(location), Translate(pivot), Rotate(angle, AxisZ), Translate(-pivot), Scale(scale).
+    inline void Set(const Vector2 &location, const Vector2 &scale, float degrees, const Vector2 &pivot) {
+        if (degrees != angle) {
+            angle = degrees;
+            float r = Rad(degrees);
+            cosAngle = cosf(r);
+            sinAngle = sinf(r);
+        }
+        a = cosAngle * scale.x; b = -sinAngle * scale.y;
+        c = sinAngle * scale.x; d =  cosAngle * scale.y;
+        tx = location.x + pivot.x - (cosAngle * pivot.x - sinAngle * pivot.y);
+        ty = location.y + pivot.y - (sinAngle * pivot.x + cosAngle * pivot.y);
+    };
+
+    // Transforms a point.
+    inline Vector2 Apply(float x, float y) const { return Vector2(a * x + b * y + tx, c * x + d * y + ty); };
+
+private:
+    float angle, cosAngle, sinAngle;
+};
+
+// Transforms corners of quads, written as x, y pairs in left-bottom,
+// left-top, right-bottom, right-top order.
+inline void TransformQuads(const Transform2D* transforms, const Rect* quads, float* corners, int count) {
+    for (int i = 0; i < count; ++i, corners += 8) {
+        const Transform2D &t = transforms[i];
+        const Rect &q = quads[i];
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+        const float xs[4] = { q.left, q.left, q.right, q.right };
+        const float ys[4] = { q.bottom, q.top, q.bottom, q.top };
+        float32x4_t x = vld1q_f32(xs);
+        float32x4_t y = vld1q_f32(ys);
+        float32x4x2_t result;
+        result.val[0] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(t.tx), x, t.a), y, t.b);
+        result.val[1] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(t.ty), x, t.c), y, t.d);
+        vst2q_f32(corners, result);
+#elif defined(__SSE__)
+        __m128 x = _mm_setr_ps(q.left, q.left, q.right, q.right);
+        __m128 y = _mm_setr_ps(q.bottom, q.top, q.bottom, q.top);
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(t.a)), _mm_mul_ps(y, _mm_set1_ps(t.b))), _mm_set1_ps(t.tx));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(t.c)), _mm_mul_ps(y, _mm_set1_ps(t.d))), _mm_set1_ps(t.ty));
+        _mm_storeu_ps(corners, _mm_unpacklo_ps(rx, ry));
+        _mm_storeu_ps(corners + 4, _mm_unpackhi_ps(rx, ry));
+#else
+        float leftX = t.a * q.left + t.tx, rightX = t.a * q.right + t.tx;
+        float leftY = t.c * q.left + t.ty, rightY = t.c * q.right + t.ty;
+        float bottomX = t.b * q.bottom, topX = t.b * q.top;
+        float bottomY = t.d * q.bottom, topY = t.d * q.top;
+        corners[0] = leftX + bottomX;  corners[1] = leftY + bottomY;
+        corners[2] = leftX + topX;     corners[3] = leftY + topY;
+        corners[4] = rightX + bottomX; corners[5] = rightY + bottomY;
+        corners[6] = rightX + topX;    corners[7] = rightY + topY;
+#endif
+    }
+};
+
 #endif // __GEOMETRY_H__
\ No newline at end of file
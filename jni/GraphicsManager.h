@@ -8,17 +8,46 @@
 
 #include "Singleton.h"
 #include "Texture.h"
+#include "TextureLoader.h"
+#include "TextureAtlas.h"
+#include "AtlasManifest.h"
+#include "Flipbook.h"
 #include "Shader.h"
+#include "RenderQueue.h"
+#include "ResolutionScaler.h"
+#include "SurfaceDamage.h"
+#include "TimeManager.h"
 
 #include <map>
+#include <string>
 #include <vector>
 
 const int DEFAULT_RENDER_WIDTH  = 360;
+const char* const ATLAS_MANIFEST_PATH = "atlas/atlas.bin";
+
+// Chooses the resolution frames are rendered at. Render coordinates stay
+// DEFAULT_RENDER_WIDTH wide whatever the policy.
+enum class ResolutionPolicy {
+    // Renders DEFAULT_RENDER_WIDTH pixels wide.
+    FIXED,
+    // Renders at the screen resolution.
+    NATIVE,
+    // Renders at the resolution scale of the screen resolution.
+    SCALED
+};
 
 class GraphicsComponent {
 public:
     virtual status load(void) = 0;
+    // Called for all components before they draw, to apply changes and
+    // report the damaged parts of the frame.
+    virtual void prepare(void) {};
     virtual void draw(void) = 0;
+    // Returns false when the next draw would repeat the last one.
+    virtual bool hasChanges(void) { return true; };
+    // Components reporting their damage through addDamage, the others
+    // have the frame redrawn whole when they change.
+    virtual bool tracksDamage(void) { return false; };
     virtual ~GraphicsComponent(void) {};
 };
 
@@ -27,16 +56,29 @@ public:
     GraphicsManager():
         renderWidth(0), renderHeight(0),
         screenWidth(0), screenHeight(0),
+        targetWidth(0), targetHeight(0), bufferWidth(0), bufferHeight(0), directRender(false),
+        resolutionPolicy(ResolutionPolicy::FIXED), resolutionScale(1.0f), resolutionScaler(), surfaceDamage(),
+        damaged(true), redrawAll(true), damageRect(), damageEmpty(true),
+        textureSlots(1), textureCompression(0),
+        textureLoader(), textureUploadBudget(DEFAULT_TEXTURE_UPLOAD_BUDGET), texturesUploaded(false),
         projectionMatrix(),
         components(),
         textures(),
         shaders(),
+        flipbooks(),
+        atlas(),
+        renderQueue(),
+        atlasResource(NULL), atlasManifest(NULL),
+        atlasPages(NULL), atlasSheets(NULL), atlasFrames(NULL),
         screenFrameBuffer(0),
         renderFrameBuffer(0),
         renderVertexBuffer(0),
         renderTexture(0),
+        renderDepthBuffer(0),
+        quadIndexBuffer(0),
         renderShader(0),
         aPosition(0), aTexture(0), uTexture(0),
+        frameStats(), totalStats(), statsFrames(0),
         display(EGL_NO_DISPLAY),
         surface(EGL_NO_CONTEXT),
         context(EGL_NO_SURFACE) {
@@ -45,6 +87,7 @@ public:
     ~GraphicsManager() {
         LOG_INFO("Destructing GraphicsManager.");
         reset();
+        unloadAtlasManifest();
     };
     int getRenderWidth() {
         return renderWidth;
@@ -58,6 +101,43 @@ public:
     int getScreenHeight() {
         return screenHeight;
     };
+    // Pixel size of the frame, which may differ from the render size.
+    int getTargetWidth() {
+        return targetWidth;
+    };
+    int getTargetHeight() {
+        return targetHeight;
+    };
+    // Takes effect when the context is started.
+    void setResolutionPolicy(ResolutionPolicy policy, float scale = 1.0f) {
+        resolutionPolicy = policy;
+        resolutionScale = CLAMP(scale, 0.1f, 1.0f);
+    };
+    // Moves the frame size between the bounds, fractions of the size
+    // chosen by the resolution policy, to render at the given frame rate.
+    // Frames rendered straight into the screen keep their size.
+    void setDynamicResolution(float minScale, float maxScale, float framesPerSecond = 60.0f) {
+        resolutionScaler.configure(minScale, maxScale, framesPerSecond);
+    };
+    int getTextureSlots() {
+        return textureSlots;
+    };
+    // Bytes of decoded images uploaded per frame, one image at least.
+    void setTextureUploadBudget(int bytes) {
+        textureUploadBudget = bytes;
+    };
+    // Blocks until textures being loaded are uploaded, for scenes which
+    // should not show placeholders.
+    void waitForTextures() {
+        if (textureLoader.wait() > 0) texturesLoaded();
+    };
+    bool isLoading() {
+        return textureLoader.isLoading();
+    };
+    // True in the frame textures replaced their placeholders.
+    bool hasUploadedTextures() {
+        return texturesUploaded;
+    };
     Vector2 screenToRender(int x, int y) {
         float nx = x * ((float)renderWidth / (float)screenWidth);
         float ny = ((float)screenHeight - y) * ((float)renderHeight / (float)screenHeight);
@@ -68,6 +148,7 @@ public:
         EGLint format, numConfigs;
         EGLConfig config;
         EGLint majorVersion, minorVersion;
+        GLint maxTextureUnits;
         // Detect if we are in emulator.
         char prop[PROP_VALUE_MAX];
         __system_property_get("ro.kernel.qemu", prop);
@@ -121,9 +202,13 @@ public:
                 || (screenWidth <= 0) || (screenHeight <= 0)) goto ERROR;
         // Set vsync.
         eglSwapInterval(display, 0);
+        // Damage extensions are optional.
+        surfaceDamage.initialize(display);
+        // New context starts with default state.
+        GLState::getInstance()->invalidate();
         // Defines and initializes offscreen surface.
         if (initializeRenderBuffer() != STATUS_OK) goto ERROR;
-        glViewport(0, 0, renderWidth, renderHeight);
+        GLState::getInstance()->viewport(0, 0, targetWidth, targetHeight);
         // Prepares the projection matrix.
         memset(projectionMatrix[0], 0, sizeof(projectionMatrix));
         projectionMatrix[0][0] =  2.0f / GLfloat(renderWidth);
@@ -133,8 +218,13 @@ public:
         projectionMatrix[3][1] = -1.0f;
         projectionMatrix[3][2] =  0.0f;
         projectionMatrix[3][3] =  1.0f;
-        // Z-Buffer is useless as we are ordering draw calls ourselves.
-        glDisable(GL_DEPTH_TEST);
+        // Z-Buffer is only used by the render queue, to reject pixels
+        // hidden by solid sprites.
+        GLState::getInstance()->setDepthTest(false);
+        // Texture units a sprite draw may sample at once.
+        glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+        textureSlots = std::min((int)maxTextureUnits, MAX_TEXTURE_UNITS);
+        textureCompression = detectTextureCompression();
         // Displays information about OpenGL.
         LOG_DEBUG("OpenGL render context information:");
         LOG_DEBUG("Renderer       : %s", (const char*)glGetString(GL_RENDERER));
@@ -143,7 +233,15 @@ public:
         LOG_DEBUG("GLSL version   : %s", (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION));
         LOG_DEBUG("OpenGL version : %d.%d", majorVersion, minorVersion);
         LOG_DEBUG("Viewport       : %d x %d", screenWidth, screenHeight);
-        LOG_DEBUG("Offscreen      : %d x %d", renderWidth, renderWidth);
+        LOG_DEBUG("Texture slots  : %d", textureSlots);
+        LOG_DEBUG("Compression    :%s%s", (textureCompression & TEXTURE_COMPRESSION_ETC1) ? " ETC1" : "",
+            (textureCompression & TEXTURE_COMPRESSION_ETC2) ? " ETC2" : "");
+        LOG_DEBUG("Render size    : %d x %d", renderWidth, renderHeight);
+        LOG_DEBUG("Frame size     : %d x %d%s", targetWidth, targetHeight, directRender ? ", direct" : "");
+        // New surface has no content yet.
+        damaged = true;
+        // Prebuilt atlas is optional.
+        if (atlasManifest == NULL) loadAtlasManifest(ATLAS_MANIFEST_PATH);
         if (components.size() > 0) {
             if (loadResources() != STATUS_OK) goto ERROR;
         }
@@ -157,18 +255,27 @@ ERROR:
         unloadResources();
         // Releases offscreen rendering resources.
         if (renderVertexBuffer != 0) {
-            glDeleteBuffers(1, &renderVertexBuffer);
+            GLState::getInstance()->deleteBuffers(1, &renderVertexBuffer);
             renderVertexBuffer = 0;
         }
         if (renderFrameBuffer != 0) {
-            glDeleteFramebuffers(1, &renderFrameBuffer);
+            GLState::getInstance()->deleteFramebuffer(renderFrameBuffer);
             renderFrameBuffer = 0;
         }
         if (renderTexture != 0) {
-            glDeleteTextures(1, &renderTexture);
+            GLState::getInstance()->deleteTexture(renderTexture);
             renderTexture = 0;
         }
+        if (renderDepthBuffer != 0) {
+            glDeleteRenderbuffers(1, &renderDepthBuffer);
+            renderDepthBuffer = 0;
+        }
         SAFE_DELETE(renderShader);        
+        renderQueue.releaseBuffers();
+        if (quadIndexBuffer != 0) {
+            GLState::getInstance()->deleteBuffers(1, &quadIndexBuffer);
+            quadIndexBuffer = 0;
+        }
         // Destroys OpenGL context.
         if (display != EGL_NO_DISPLAY) {
             eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
@@ -193,6 +300,16 @@ ERROR:
         return STATUS_OK;
     };
     void unloadResources() {
+        // Textures being loaded are released below.
+        textureLoader.cancel();
+        PixelBufferPool::getInstance()->trim();
+        // Releases atlas pages.
+        atlas.unload();
+        // Stops streaming flipbooks.
+        for (std::map<const char*, Flipbook*>::iterator it = flipbooks.begin(); it != flipbooks.end(); ++it) {
+            SAFE_DELETE(it->second);
+        }
+        flipbooks.clear();
         // If already released.
         if (textures.size() == 0 && shaders.size() == 0) return;
         // Releases textures.
@@ -203,7 +320,7 @@ ERROR:
         textures.clear();
         // Releases shaders.
         LOG_DEBUG("Found %d shaders.", shaders.size());
-        for (std::map<const char*, Shader*>::iterator it = shaders.begin(); it != shaders.end(); ++it) {
+        for (std::map<std::string, Shader*>::iterator it = shaders.begin(); it != shaders.end(); ++it) {
             SAFE_DELETE(it->second);
         };
         shaders.clear();
@@ -212,82 +329,264 @@ ERROR:
         LOG_DEBUG("Register GraphicsComponent %d", components.size() + 1);
         components.push_back(component);
         component->load();
+        damaged = true;
     };
     void reset() {
         unloadResources();
+        atlas.reset();
         // Releases graphics components.
         LOG_DEBUG("Delete %d graphic components.", components.size());
         for (std::vector<GraphicsComponent*>::iterator it = components.begin(); it < components.end(); ++it) {
             SAFE_DELETE(*it);
         }
         components.clear();
+        renderQueue.clearLayers();
+        damaged = true;
+    };
+    // Forces the next frame to be rendered, when the screen content was
+    // lost or changed outside of graphics components.
+    void markDamaged() {
+        damaged = true;
+    };
+    // Adds a part of the frame, in render coordinates, to be redrawn.
+    void addDamage(const Rect& rect) {
+        if (damageEmpty) {
+            damageRect = rect;
+            damageEmpty = false;
+            return;
+        }
+        damageRect.left = std::min(damageRect.left, rect.left);
+        damageRect.bottom = std::min(damageRect.bottom, rect.bottom);
+        damageRect.right = std::max(damageRect.right, rect.right);
+        damageRect.top = std::max(damageRect.top, rect.top);
+    };
+    // True when bounds have to be drawn in the current frame.
+    bool isDamaged(const Rect& bounds) {
+        if (redrawAll) return true;
+        return !damageEmpty && bounds.right >= damageRect.left && bounds.left <= damageRect.right
+            && bounds.top >= damageRect.bottom && bounds.bottom <= damageRect.top;
+    };
+    // True when the next frame would differ from the one shown.
+    bool hasChanges() {
+        if (damaged || textureLoader.isLoading()) return true;
+        for (std::vector<GraphicsComponent*>::iterator it = components.begin(); it < components.end(); ++it) {
+            if ((*it)->hasChanges()) return true;
+        }
+        return false;
+    };
+    // Components of a cached layer are rendered into their own target,
+    // which is composited as is until one of them invalidates the layer.
+    void setLayerCached(int layer, bool cached) {
+        renderQueue.setLayerCached(layer, cached);
+    };
+    void invalidateLayer(int layer) {
+        renderQueue.invalidateLayer(layer);
     };
     status update() {
-        // Uses the offscreen FBO for scene rendering.
-        glBindFramebuffer(GL_FRAMEBUFFER, renderFrameBuffer);
-        glViewport(0, 0, renderWidth, renderHeight);
+        double renderStart = PlatformGetTime();
+        GLState* state = GLState::getInstance();
+        memset(&frameStats, 0, sizeof(frameStats));
+        // Decoded textures are uploaded within the frame budget.
+        if (textureLoader.update(textureUploadBudget) > 0) texturesLoaded();
+        // Nothing changed, the shown frame stays and nothing is rendered
+        // nor swapped. Resolution scaler does not measure the pause.
+        if (!hasChanges()) {
+            frameStats.idleFrames = 1;
+            resolutionScaler.reset();
+            return STATUS_OK;
+        }
+        // Offscreen buffer keeps the last frame, only its damaged part
+        // is redrawn. Window surface content is lost on swap.
+        redrawAll = damaged || directRender;
+        for (std::vector<GraphicsComponent*>::iterator it = components.begin(); it < components.end(); ++it) {
+            if (!(*it)->tracksDamage() && (*it)->hasChanges()) redrawAll = true;
+        }
+        damaged = false;
+        damageEmpty = true;
+        for (std::vector<GraphicsComponent*>::iterator it = components.begin(); it < components.end(); ++it) {
+            (*it)->prepare();
+        }
+        texturesUploaded = false;
+        GLint scissorRect[4] = { 0, 0, targetWidth, targetHeight };
+        if (!redrawAll) {
+            // Changes were not visible.
+            if (damageEmpty) {
+                frameStats.idleFrames = 1;
+                return STATUS_OK;
+            }
+            // Damage in pixels, one more pixel around for filtering.
+            float scaleX = float(targetWidth) / float(renderWidth);
+            float scaleY = float(targetHeight) / float(renderHeight);
+            int left = std::max(0, (int)floorf(damageRect.left * scaleX) - 1);
+            int bottom = std::max(0, (int)floorf(damageRect.bottom * scaleY) - 1);
+            int right = std::min(targetWidth, (int)ceilf(damageRect.right * scaleX) + 1);
+            int top = std::min(targetHeight, (int)ceilf(damageRect.top * scaleY) + 1);
+            scissorRect[0] = left;
+            scissorRect[1] = bottom;
+            scissorRect[2] = std::max(0, right - left);
+            scissorRect[3] = std::max(0, top - bottom);
+            redrawAll = (scissorRect[2] == targetWidth && scissorRect[3] == targetHeight);
+        }
+        frameStats.redrawnPixels = scissorRect[2] * scissorRect[3];
+        // Same damage on the screen, the blit filters one more pixel.
+        EGLint screenDamage[4] = { 0, 0, screenWidth, screenHeight };
+        if (!redrawAll) {
+            float scaleX = float(screenWidth) / float(targetWidth);
+            float scaleY = float(screenHeight) / float(targetHeight);
+            int left = std::max(0, (int)floorf(scissorRect[0] * scaleX) - 1);
+            int bottom = std::max(0, (int)floorf(scissorRect[1] * scaleY) - 1);
+            int right = std::min(screenWidth, (int)ceilf((scissorRect[0] + scissorRect[2]) * scaleX) + 1);
+            int top = std::min(screenHeight, (int)ceilf((scissorRect[1] + scissorRect[3]) * scaleY) + 1);
+            screenDamage[0] = left;
+            screenDamage[1] = bottom;
+            screenDamage[2] = right - left;
+            screenDamage[3] = top - bottom;
+        }
+        // Back buffer may keep an older frame, then more is redrawn.
+        EGLint screenRegion[4];
+        surfaceDamage.begin(display, surface, screenDamage, screenWidth, screenHeight, screenRegion);
+        state->takeRedundantCalls();
+        // Uses the offscreen FBO for scene rendering, unless frames are
+        // rendered straight into the screen.
+        RenderTarget target = { directRender ? (GLuint)screenFrameBuffer : renderFrameBuffer,
+            targetWidth, targetHeight, renderWidth, renderHeight, !redrawAll };
+        state->bindFramebuffer(target.frameBuffer);
+        state->viewport(0, 0, targetWidth, targetHeight);
+        // Clear and draws are limited to the damaged part.
+        state->setScissorTest(target.scissorTest);
+        if (target.scissorTest) state->scissor(scissorRect[0], scissorRect[1], scissorRect[2], scissorRect[3]);
         glClearColor(0.1f, 0.1f, 0.1f, 0.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        // Render graphic components.
+        // Depth writes must be enabled for the depth clear.
+        state->setDepthMask(true);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // Graphic components submit their draw commands, which are
+        // rendered at once.
+        renderQueue.clear();
         for (std::vector<GraphicsComponent*>::iterator it = components.begin(); it < components.end(); ++it) {
             (*it)->draw();
         }
-        // The FBO is rendered and scaled into the screen.
-        glBindFramebuffer(GL_FRAMEBUFFER, screenFrameBuffer);
+        renderQueue.flush(projectionMatrix[0], getQuadIndexBuffer(), target, frameStats);
+        state->setScissorTest(false);
+        if (!directRender) blitRenderBuffer(screenRegion);
+        frameStats.redundantStateCalls = state->takeRedundantCalls();
+        // Shows the result to the user.
+        double swapStart = PlatformGetTime();
+        if (surfaceDamage.swap(display, surface, screenDamage) != EGL_TRUE) {
+            LOG_ERROR("Error %d swapping buffers.", eglGetError());
+            return STATUS_ERROR;
+        }
+        // Frame size follows the measured frame time.
+        if (!directRender && resolutionScaler.update(TimeManager::getInstance()->getFrameElapsedTime(),
+                swapStart - renderStart, PlatformGetTime() - swapStart)) {
+            applyResolutionScale();
+        }
+        return STATUS_OK;
+    };
+    // Compressed texture formats the GPU samples, TEXTURE_COMPRESSION_*.
+    int detectTextureCompression() {
+        int compression = 0;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        if (count > 0) {
+            std::vector<GLint> formats(count);
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, &formats[0]);
+            for (int i = 0; i < count; ++i) {
+                if (formats[i] == GL_ETC1_RGB8_OES) compression |= TEXTURE_COMPRESSION_ETC1;
+                if (formats[i] == GL_COMPRESSED_RGBA8_ETC2_EAC) compression |= TEXTURE_COMPRESSION_ETC2;
+            }
+        }
+        // Some drivers only list ETC1 in their extensions.
+        const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+        if (extensions != NULL && strstr(extensions, "GL_OES_compressed_ETC1_RGB8_texture") != NULL) {
+            compression |= TEXTURE_COMPRESSION_ETC1;
+        }
+        return compression;
+    };
+    // The FBO is rendered and scaled into the screen, within region when
+    // the rest of the back buffer is still valid.
+    void blitRenderBuffer(const EGLint* region) {
+        GLState* state = GLState::getInstance();
+        state->bindFramebuffer(screenFrameBuffer);
+        bool partial = (region[2] < screenWidth || region[3] < screenHeight);
+        state->setScissorTest(partial);
+        if (partial) state->scissor(region[0], region[1], region[2], region[3]);
         glClear(GL_COLOR_BUFFER_BIT);
-        glViewport(0, 0, screenWidth, screenHeight);
+        state->viewport(0, 0, screenWidth, screenHeight);
+        state->setDepthTest(false);
+        state->setBlend(false);
         // Select the offscreen texture as source.
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, renderTexture);
+        state->bindTexture(0, renderTexture);
         renderShader->apply();
         glUniform1i(uTexture, 0);
         // Indicates to OpenGL how position and uv coordinates are stored.
-        glBindBuffer(GL_ARRAY_BUFFER, renderVertexBuffer);
-        glEnableVertexAttribArray(aPosition);
+        state->bindBuffer(GL_ARRAY_BUFFER, renderVertexBuffer);
+        state->setVertexAttribArrays((1 << aPosition) | (1 << aTexture));
         glVertexAttribPointer(aPosition, 2, GL_FLOAT, GL_FALSE, sizeof(RenderVertex), (GLvoid*) 0);
-        glEnableVertexAttribArray(aTexture);
         glVertexAttribPointer(aTexture, 2, GL_FLOAT, GL_FALSE, sizeof(RenderVertex), (GLvoid*) (sizeof(GLfloat) * 2));
         // Renders the offscreen buffer into screen.
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-        // Restores device state.
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // Shows the result to the user.
-        if (eglSwapBuffers(display, surface) != EGL_TRUE) {
-            LOG_ERROR("Error %d swapping buffers.", eglGetError());
-            return STATUS_ERROR;
-        } else {
-            return STATUS_OK;
-        }
+        countDrawCall();
+        state->setScissorTest(false);
     };
     status initializeRenderBuffer() {
         LOG_INFO("Loading offscreen buffer.");
-        const RenderVertex vertices[] = {
-            {-1.0f, -1.0f, 0.0f, 0.0f },
-            {-1.0f,  1.0f, 0.0f, 1.0f },
-            { 1.0f, -1.0f, 1.0f, 0.0f },
-            { 1.0f,  1.0f, 1.0f, 1.0f }
-        };
-        float screenRatio = float(screenHeight) / float(screenWidth);
+        // Height of the screen ratio, rounded in integers so that a frame
+        // of the screen width gets the screen height.
         renderWidth = DEFAULT_RENDER_WIDTH;
-        renderHeight = float(renderWidth) * screenRatio;
+        renderHeight = (renderWidth * screenHeight + screenWidth / 2) / screenWidth;
         glGetIntegerv(GL_FRAMEBUFFER_BINDING, &screenFrameBuffer);
+        switch (resolutionPolicy) {
+            case ResolutionPolicy::FIXED:
+                bufferWidth = renderWidth;
+                bufferHeight = renderHeight;
+                break;
+            case ResolutionPolicy::NATIVE:
+                bufferWidth = screenWidth;
+                bufferHeight = screenHeight;
+                break;
+            case ResolutionPolicy::SCALED:
+                bufferWidth = std::max(1, (int)(screenWidth * resolutionScale));
+                bufferHeight = std::max(1, (int)(screenHeight * resolutionScale));
+                break;
+        }
+        // Frame as large as the screen, like on most watches, is rendered
+        // into the window surface. Its depth buffer serves the solid pass.
+        directRender = (bufferWidth == screenWidth && bufferHeight == screenHeight)
+            || (resolutionPolicy == ResolutionPolicy::FIXED && renderWidth == screenWidth);
+        if (directRender) {
+            LOG_INFO("Offscreen buffer not needed, rendering to the screen.");
+            bufferWidth = targetWidth = screenWidth;
+            bufferHeight = targetHeight = screenHeight;
+            return STATUS_OK;
+        }
+        // Buffer holds the largest frame, smaller ones are rendered into
+        // its lower left corner, so scaling never reallocates it.
+        bufferWidth = std::max(1, (int)(bufferWidth * resolutionScaler.getMaxScale()));
+        bufferHeight = std::max(1, (int)(bufferHeight * resolutionScaler.getMaxScale()));
+        resolutionScaler.reset();
         // Creates a texture for off-screen rendering.
         glGenTextures(1, &renderTexture);
-        glBindTexture(GL_TEXTURE_2D, renderTexture);
+        GLState::getInstance()->bindTexture(0, renderTexture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, renderWidth, renderHeight, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, NULL);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bufferWidth, bufferHeight, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, NULL);
         // Attaches the texture to the new framebuffer.
         glGenFramebuffers(1, &renderFrameBuffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, renderFrameBuffer);
+        GLState::getInstance()->bindFramebuffer(renderFrameBuffer);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderTexture, 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // Attaches a depth buffer for the solid pass.
+        glGenRenderbuffers(1, &renderDepthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderDepthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, bufferWidth, bufferHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderDepthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) goto ERROR;
+        GLState::getInstance()->bindTexture(0, 0);
+        GLState::getInstance()->bindFramebuffer(0);
         // Creates the vertex buffer.
-        renderVertexBuffer = initVertexBuffer(vertices, sizeof(vertices));
-        if (renderVertexBuffer == 0) goto ERROR;
+        if (applyResolutionScale() != STATUS_OK) goto ERROR;
         // Creates the shader used to render texture to screen.
         renderShader = new Shader();
         if (renderShader->loadFromFile("shaders/Render.shader") != STATUS_OK) goto ERROR;
@@ -295,32 +594,174 @@ ERROR:
         aPosition = glGetAttribLocation(renderShader->getProgramId(),"aPosition");
         aTexture  = glGetAttribLocation(renderShader->getProgramId(), "aTexture");
         uTexture  = glGetUniformLocation(renderShader->getProgramId(),"uTexture");
+        if (!GLState::isAttribLocationValid(aPosition) || !GLState::isAttribLocationValid(aTexture)) goto ERROR;
         return STATUS_OK;
 ERROR:
         LOG_ERROR("Error while loading offscreen buffer.");
         return STATUS_ERROR;
     };
+    // Sizes the frame from the scaler. The blit vertices sample only the
+    // rendered part of the offscreen buffer.
+    status applyResolutionScale() {
+        float scale = resolutionScaler.getScale() / resolutionScaler.getMaxScale();
+        targetWidth = std::max(1, (int)(bufferWidth * scale));
+        targetHeight = std::max(1, (int)(bufferHeight * scale));
+        damaged = true;
+        // Layer targets follow the frame size.
+        renderQueue.invalidateLayers();
+        GLfloat u = GLfloat(targetWidth) / GLfloat(bufferWidth);
+        GLfloat v = GLfloat(targetHeight) / GLfloat(bufferHeight);
+        const RenderVertex vertices[] = {
+            {-1.0f, -1.0f, 0.0f, 0.0f },
+            {-1.0f,  1.0f, 0.0f, v },
+            { 1.0f, -1.0f, u, 0.0f },
+            { 1.0f,  1.0f, u, v }
+        };
+        LOG_DEBUG("Frame size %d x %d.", targetWidth, targetHeight);
+        if (renderVertexBuffer == 0) {
+            renderVertexBuffer = initVertexBuffer(vertices, sizeof(vertices));
+            return (renderVertexBuffer != 0) ? STATUS_OK : STATUS_ERROR;
+        }
+        GLState::getInstance()->bindBuffer(GL_ARRAY_BUFFER, renderVertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+        return STATUS_OK;
+    };
     Texture* loadTexture(const char* path, int filter, int mode) {
         // Reuse texture, if already loaded.
         std::map<const char*, Texture*>::iterator it = textures.find(path);
         if (it != textures.end()) return it->second;
-        // Appends a new texture to the texture map.
+        // Appends a new texture to the texture map. Compressed images are
+        // uploaded at once, others have a placeholder until decoded.
         Texture* texture = new Texture();
-        if (texture->loadFromFile(path, filter, mode) != STATUS_OK) goto ERROR;
+        if (texture->loadCompressed(path, filter, mode, textureCompression) != STATUS_OK) {
+            if (texture->createPlaceholder(path, filter, mode) != STATUS_OK) goto ERROR;
+            textureLoader.submit(texture, path);
+        }
         textures.insert(std::pair<const char*, Texture*>(path, texture));
         return texture;
 ERROR:
         SAFE_DELETE(texture);
         return NULL;
     };
-    Shader* loadShader(const char* path) {
+    // Maps prebuilt atlas manifest, its content is used in place.
+    status loadAtlasManifest(const char* path) {
+        const uint8_t* data;
+        off_t size;
+        atlasResource = new Resource(path);
+        data = (const uint8_t*)atlasResource->map();
+        if (data == NULL) goto ERROR;
+        size = atlasResource->getLength();
+        atlasManifest = (const AtlasManifestHeader*)data;
+        if (size < (off_t)sizeof(AtlasManifestHeader)
+                || atlasManifest->magic != ATLAS_MANIFEST_MAGIC
+                || atlasManifest->version != ATLAS_MANIFEST_VERSION) goto ERROR;
+        if (size < (off_t)(sizeof(AtlasManifestHeader)
+                + atlasManifest->pageCount * sizeof(AtlasPage)
+                + atlasManifest->sheetCount * sizeof(AtlasSheet)
+                + atlasManifest->frameCount * sizeof(AtlasFrame))) goto ERROR;
+        atlasPages = (const AtlasPage*)(data + sizeof(AtlasManifestHeader));
+        atlasSheets = (const AtlasSheet*)(atlasPages + atlasManifest->pageCount);
+        atlasFrames = (const AtlasFrame*)(atlasSheets + atlasManifest->sheetCount);
+        LOG_INFO("Atlas manifest has %d sheets in %d pages.", atlasManifest->sheetCount, atlasManifest->pageCount);
+        return STATUS_OK;
+ERROR:
+        LOG_INFO("No atlas manifest, images are packed at runtime.");
+        unloadAtlasManifest();
+        return STATUS_ERROR;
+    };
+    void unloadAtlasManifest() {
+        if (atlasResource != NULL) atlasResource->close();
+        SAFE_DELETE(atlasResource);
+        atlasManifest = NULL;
+    };
+    // Binary search of the first sheet with the path hash, sheets sharing
+    // the hash follow it and are told apart by name.
+    const AtlasSheet* findAtlasSheet(const char* path) {
+        if (atlasManifest == NULL) return NULL;
+        uint32_t hash = atlasNameHash(path);
+        int low = 0, high = (int)atlasManifest->sheetCount;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (atlasSheets[middle].nameHash < hash) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        for (; low < (int)atlasManifest->sheetCount && atlasSheets[low].nameHash == hash; ++low) {
+            if (strncmp(atlasSheets[low].name, path, ATLAS_PATH_SIZE) == 0) return &atlasSheets[low];
+        }
+        return NULL;
+    };
+    // Finds the flipbook streamed in place of a sprite sheet image, as
+    // "textures/Image.flb" for "textures/Image.png". Images without one
+    // are remembered, so they are looked for once.
+    Flipbook* loadFlipbook(const char* path) {
+        std::map<const char*, Flipbook*>::iterator it = flipbooks.find(path);
+        if (it != flipbooks.end()) return it->second;
+        std::string flipbookPath(path);
+        size_t extension = flipbookPath.rfind('.');
+        if (extension != std::string::npos) flipbookPath.erase(extension);
+        flipbookPath += FLIPBOOK_EXTENSION;
+        Flipbook* flipbook = new Flipbook(flipbookPath);
+        if (flipbook->load() != STATUS_OK) SAFE_DELETE(flipbook);
+        flipbooks.insert(std::pair<const char*, Flipbook*>(path, flipbook));
+        return flipbook;
+    };
+    // Adds image to the shared texture atlas.
+    void registerAtlasImage(const char* path) {
+        // Prebuilt sheets need no packing.
+        if (findAtlasSheet(path) != NULL) return;
+        atlas.registerImage(path);
+    };
+    // Finds image in the prebuilt or runtime atlas, or loads it as standalone texture.
+    status loadTextureRegion(const char* path, int filter, int mode, TextureRegion& region) {
+        Texture* texture;
+        region.frames = NULL;
+        region.frameCount = 0;
+        region.solid = false;
+        const AtlasSheet* sheet = findAtlasSheet(path);
+        if (sheet != NULL && sheet->page < atlasManifest->pageCount
+                && sheet->firstFrame + sheet->frameCount <= atlasManifest->frameCount) {
+            texture = loadTexture(atlasPages[sheet->page].path, filter, mode);
+            if (texture == NULL) return STATUS_ERROR;
+            region.texture = texture;
+            region.x = 0;
+            region.y = 0;
+            region.width = texture->getWidth();
+            region.height = texture->getHeight();
+            region.frames = &atlasFrames[sheet->firstFrame];
+            region.frameCount = sheet->frameCount;
+            // Sheet is solid when all of its visible frames are.
+            for (int i = 0; i < region.frameCount; ++i) {
+                if (region.frames[i].width == 0) continue;
+                region.solid = (region.frames[i].flags & ATLAS_FRAME_SOLID) != 0;
+                if (!region.solid) break;
+            }
+            return STATUS_OK;
+        }
+        if (atlas.findRegion(path, region)) return STATUS_OK;
+        texture = loadTexture(path, filter, mode);
+        if (texture == NULL) return STATUS_ERROR;
+        region.texture = texture;
+        region.x = 0;
+        region.y = 0;
+        region.width = texture->getWidth();
+        region.height = texture->getHeight();
+        region.solid = texture->isSolid();
+        return STATUS_OK;
+    };
+    Shader* loadShader(const char* path, const char* defines = NULL) {
+        // Variants are cached apart from the plain shader.
+        std::string key = path;
+        if (defines != NULL) key.append(defines);
         // Finds out if shader already loaded.
-        std::map<const char*, Shader*>::iterator it = shaders.find(path);
+        std::map<std::string, Shader*>::iterator it = shaders.find(key);
         if (it != shaders.end()) return it->second;
         // Appends a new shader to the shader map.
         Shader* shader = new Shader();
-        if (shader->loadFromFile(path) != STATUS_OK) goto ERROR;
-        shaders.insert(std::pair<const char*, Shader*>(path, shader));
+        if (shader->loadFromFile(path, defines) != STATUS_OK) goto ERROR;
+        shaders.insert(std::pair<std::string, Shader*>(key, shader));
         return shader;
 ERROR:
         SAFE_DELETE(shader);
@@ -330,21 +771,88 @@ ERROR:
         GLuint vertexBuffer;
         // Upload specified memory buffer into OpenGL.
         glGenBuffers(1, &vertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        GLState::getInstance()->bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
         glBufferData(GL_ARRAY_BUFFER, bufferSize, buffer, GL_STATIC_DRAW);
-        // Unbinds the buffer.
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
         if (glGetError() != GL_NO_ERROR) goto ERROR;
         return vertexBuffer;
 ERROR:
         LOG_ERROR("Error loading vertex buffer.");
-        if (vertexBuffer > 0) glDeleteBuffers(1, &vertexBuffer);
+        if (vertexBuffer > 0) GLState::getInstance()->deleteBuffers(1, &vertexBuffer);
         return 0;
     };
+    // Index buffer of MAX_QUADS quads shared by all draws, built once
+    // per OpenGL context.
+    GLuint getQuadIndexBuffer() {
+        if (quadIndexBuffer != 0) return quadIndexBuffer;
+        std::vector<GLushort> indexes(MAX_QUADS * 6);
+        for (int n = 0; n < MAX_QUADS; ++n) {
+            // Points to 1st vertex.
+            GLushort index = n * 4;
+            GLushort* quad = &indexes[n * 6];
+            quad[0] = index+0;
+            quad[1] = index+1;
+            quad[2] = index+2;
+            quad[3] = index+2;
+            quad[4] = index+1;
+            quad[5] = index+3;
+        }
+        glGenBuffers(1, &quadIndexBuffer);
+        GLState::getInstance()->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexes.size() * sizeof(GLushort), &indexes[0], GL_STATIC_DRAW);
+        countUpload(indexes.size() * sizeof(GLushort));
+        if (glGetError() != GL_NO_ERROR) {
+            LOG_ERROR("Error creating quad index buffer.");
+            GLState::getInstance()->deleteBuffers(1, &quadIndexBuffer);
+            quadIndexBuffer = 0;
+        }
+        return quadIndexBuffer;
+    };
+    RenderQueue* getRenderQueue() {
+        return &renderQueue;
+    };
     GLfloat* getProjectionMatrix() {
         return projectionMatrix[0];
     };
+    // Rendering counters.
+    void countDrawCall() {
+        frameStats.drawCalls++;
+    };
+    void countUpload(int bytes) {
+        frameStats.bytesUploaded += bytes;
+    };
+    void countCulled(int sprites) {
+        frameStats.culledSprites += sprites;
+    };
+    RenderStats getRenderStats() {
+        return frameStats;
+    };
+    void logRenderStats(int frames = 60) {
+        totalStats.drawCalls += frameStats.drawCalls;
+        totalStats.bytesUploaded += frameStats.bytesUploaded;
+        totalStats.redundantStateCalls += frameStats.redundantStateCalls;
+        totalStats.culledSprites += frameStats.culledSprites;
+        totalStats.layerRedraws += frameStats.layerRedraws;
+        totalStats.idleFrames += frameStats.idleFrames;
+        totalStats.redrawnPixels += frameStats.redrawnPixels;
+        if (++statsFrames < frames) return;
+        LOG_INFO("Per frame: %d draw calls, %d bytes uploaded, %d state calls skipped, %d sprites culled.",
+            totalStats.drawCalls / statsFrames, totalStats.bytesUploaded / statsFrames,
+            totalStats.redundantStateCalls / statsFrames, totalStats.culledSprites / statsFrames);
+        LOG_INFO("Cached layers redrawn %d times, %d idle frames in %d frames.",
+            totalStats.layerRedraws, totalStats.idleFrames, statsFrames);
+        LOG_INFO("Per frame: %d pixels redrawn of %d.", totalStats.redrawnPixels / statsFrames, targetWidth * targetHeight);
+        memset(&totalStats, 0, sizeof(totalStats));
+        statsFrames = 0;
+    };
 private:
+    // Placeholders were replaced, the frame and cached layers are redrawn.
+    void texturesLoaded() {
+        texturesUploaded = true;
+        damaged = true;
+        renderQueue.invalidateLayers();
+        // Buffers are only reused while images are loading.
+        if (!textureLoader.isLoading()) PixelBufferPool::getInstance()->trim();
+    };
     struct RenderVertex {
         GLfloat x, y, u, v;
     };
@@ -353,6 +861,29 @@ private:
     int renderHeight;
     int screenWidth;
     int screenHeight;
+    int targetWidth;
+    int targetHeight;
+    // Allocated size of the offscreen buffer.
+    int bufferWidth;
+    int bufferHeight;
+    // Set when frames are rendered straight into the screen.
+    bool directRender;
+    ResolutionPolicy resolutionPolicy;
+    float resolutionScale;
+    ResolutionScaler resolutionScaler;
+    SurfaceDamage surfaceDamage;
+    // Set when the next frame has to be rendered whatever components say.
+    bool damaged;
+    // Set when the current frame is redrawn whole, else only the damage
+    // rectangle is.
+    bool redrawAll;
+    Rect damageRect;
+    bool damageEmpty;
+    int textureSlots;
+    int textureCompression;
+    TextureLoader textureLoader;
+    int textureUploadBudget;
+    bool texturesUploaded;
     GLfloat projectionMatrix[4][4];
     EGLDisplay display;
     EGLSurface surface;
@@ -360,14 +891,29 @@ private:
     // Graphics resources.
     std::vector<GraphicsComponent*> components;
     std::map<const char*, Texture*> textures;
-    std::map<const char*, Shader*> shaders;
+    std::map<std::string, Shader*> shaders;
+    std::map<const char*, Flipbook*> flipbooks;
+    TextureAtlas atlas;
+    RenderQueue renderQueue;
+    // Prebuilt atlas.
+    Resource* atlasResource;
+    const AtlasManifestHeader* atlasManifest;
+    const AtlasPage* atlasPages;
+    const AtlasSheet* atlasSheets;
+    const AtlasFrame* atlasFrames;
     // Rendering resources.
     GLint screenFrameBuffer;
     GLuint renderFrameBuffer;
     GLuint renderVertexBuffer;
     GLuint renderTexture;
+    GLuint renderDepthBuffer;
+    GLuint quadIndexBuffer;
     Shader* renderShader;
-    GLuint aPosition, aTexture, uTexture;
+    GLint aPosition, aTexture, uTexture;
+    // Statistics.
+    RenderStats frameStats;
+    RenderStats totalStats;
+    int statsFrames;
 };
 
 #endif //  __GRAPHICSMANAGER_H__
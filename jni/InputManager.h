@@ -71,7 +71,9 @@ public:
         gesturePointer0Delta(0),
         gesturePointer1Delta(0),
         gestureDraging(false),
-        gesturePinching(false) {
+        gesturePinching(false),
+        eventsPending(false),
+        eventsHandled(false) {
         LOG_INFO("Creating InputManager.");
         //
     };
@@ -84,8 +86,14 @@ public:
     };
     status update() {
         // Clears previous state.
+        eventsHandled = eventsPending;
+        eventsPending = false;
         return STATUS_OK;
     };
+    // True when no event arrived since the previous step.
+    bool isIdle() {
+        return !eventsHandled;
+    };
     void stop() {
         LOG_INFO("Stopping InputManager.");
     };
@@ -99,6 +107,7 @@ public:
         listeners.erase(std::find(listeners.begin(), listeners.end(), listener));
     };
     int32_t onTouchEvent(AInputEvent* event) {
+        eventsPending = true;
 #ifdef INPUTMANAGER_LOG_EVENTS
         LOG_DEBUG("AMotionEvent_getAction=%d", AMotionEvent_getAction(event));
         LOG_DEBUG("AMotionEvent_getFlags=%d", AMotionEvent_getFlags(event));
@@ -314,6 +323,7 @@ public:
         return 0;
     };
     int32_t onKeyboardEvent(AInputEvent* event) {
+        eventsPending = true;
 #ifdef INPUTMANAGER_LOG_EVENTS
         LOG_DEBUG("AKeyEvent_getAction=%d", AKeyEvent_getAction(event));
         LOG_DEBUG("AKeyEvent_getFlags=%d", AKeyEvent_getFlags(event));
@@ -340,6 +350,7 @@ public:
         return 0;
     };
     int32_t onTrackballEvent(AInputEvent* event) {
+        eventsPending = true;
 #ifdef INPUTMANAGER_LOG_EVENTS
         LOG_DEBUG("AMotionEvent_getAction=%d", AMotionEvent_getAction(event));
         LOG_DEBUG("AMotionEvent_getFlags=%d", AMotionEvent_getFlags(event));
@@ -365,6 +376,7 @@ public:
         return 0;
     };
     int32_t onAccelerometerEvent(ASensorEvent* event) {
+        eventsPending = true;
     #ifdef INPUTMANAGER_LOG_SENSOR_EVENTS
         LOG_DEBUG("ASensorEvent=%d", event->version);
         LOG_DEBUG("ASensorEvent=%d", event->sensor);
@@ -440,6 +452,9 @@ private:
     std::pair<int, int> gesturePinchCentroid;
     int gesturePointer0Delta;
     int gesturePointer1Delta;
+    // Events received since the last step, and during it.
+    bool eventsPending;
+    bool eventsHandled;
     std::vector<InputListener*> listeners;
 };
 
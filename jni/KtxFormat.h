@@ -0,0 +1,60 @@
+#ifndef __KTXFORMAT_H__
+#define __KTXFORMAT_H__
+
+/* KTX 1.1 container of compressed textures, written by tools/ktx */
+
+#include <stdint.h>
+
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+// Compressed formats a texture may be loaded from.
+const int TEXTURE_COMPRESSION_ETC1 = 1 << 0;
+const int TEXTURE_COMPRESSION_ETC2 = 1 << 1;
+
+// File layout: identifier, header, key/value data, then the size and the
+// data of each mipmap level. Rows are bottom-up, as textures are uploaded.
+const uint8_t KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+const uint32_t KTX_ENDIANNESS = 0x04030201;
+const char* const KTX_EXTENSION = ".ktx";
+
+struct KtxHeader {
+    uint8_t identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+// Bytes of a 4x4 block, 0 for formats which are not supported.
+inline int ktxBlockSize(uint32_t internalFormat) {
+    switch (internalFormat) {
+        case GL_ETC1_RGB8_OES: return 8;
+        case GL_COMPRESSED_RGBA8_ETC2_EAC: return 16;
+    }
+    return 0;
+};
+
+// Compression needed to upload the format.
+inline int ktxCompression(uint32_t internalFormat) {
+    return (internalFormat == GL_ETC1_RGB8_OES) ? TEXTURE_COMPRESSION_ETC1 : TEXTURE_COMPRESSION_ETC2;
+};
+
+inline uint32_t ktxImageSize(uint32_t internalFormat, uint32_t width, uint32_t height) {
+    return ((width + 3) / 4) * ((height + 3) / 4) * ktxBlockSize(internalFormat);
+};
+
+#endif // __KTXFORMAT_H__
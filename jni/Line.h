@@ -3,22 +3,26 @@
 
 /* Simple OpenGL rounded corner line */
 
+#include <algorithm>
 #include <vector>
 
-class Line: public GraphicsComponent {
+class Line: public GraphicsComponent, public RenderCallback {
 public:
     Line(float thickness):
         thickness(thickness),
         color(Vector(1.0f, 1.0f, 1.0f)),
         opaque(1.0f),
+        layer(0),
+        points(), vertices(), bounds(), drawnBounds(),
+        drawnColor(color), drawnOpaque(opaque), drawn(false), moved(false),
         shaderProgram(0),
-        aPosition(0), uProjection(0), uColor(0), uOpaque(0) {
+        aPosition(0), uProjection(0), uColor(0), uOpaque(0), vbo(0) {
         LOG_DEBUG("Create Line.");
         GraphicsManager::getInstance()->registerComponent(this);
     };
     ~Line() {
         LOG_DEBUG("Delete Line.");
-        glDeleteBuffers(1, &vbo);
+        GLState::getInstance()->deleteBuffers(1, &vbo);
     }
     status load() {
         Shader* shader = GraphicsManager::getInstance()->loadShader("shaders/Line.shader");
@@ -27,21 +31,48 @@ public:
         uProjection = glGetUniformLocation(shaderProgram, "uProjection");
         uColor = glGetUniformLocation(shaderProgram, "uColor");
         uOpaque = glGetUniformLocation(shaderProgram, "uOpaque");
+        if (!GLState::isAttribLocationValid(aPosition)) {
+            LOG_ERROR("Error while loading line shader.");
+            return STATUS_ERROR;
+        }
         return STATUS_OK;
     };
+    // Damages the old and the new place of the line once it moved, and
+    // its place when it is painted differently.
+    void prepare() {
+        if (!hasChanges()) return;
+        GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+        if (moved) {
+            if (drawn) graphicsManager->addDamage(drawnBounds);
+            drawnBounds = bounds;
+            drawn = (vertices.size() >= 6);
+        }
+        if (drawn) graphicsManager->addDamage(drawnBounds);
+        drawnColor = color;
+        drawnOpaque = opaque;
+        moved = false;
+    };
+    bool hasChanges() {
+        return moved || color != drawnColor || opaque != drawnOpaque;
+    };
+    bool tracksDamage() {
+        return true;
+    };
     void draw() {
         if (vertices.size() < 6) return;
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glUseProgram(shaderProgram);
+        GraphicsManager::getInstance()->getRenderQueue()->submitCallback(layer, this);
+    };
+    void render() {
+        GLState* state = GLState::getInstance();
+        state->bindBuffer(GL_ARRAY_BUFFER, vbo);
+        state->useProgram(shaderProgram);
+        state->setBlend(false);
         glUniformMatrix4fv(uProjection, 1, GL_FALSE, GraphicsManager::getInstance()->getProjectionMatrix());
-        glEnableVertexAttribArray(aPosition);
+        state->setVertexAttribArrays(1 << aPosition);
         glVertexAttribPointer(aPosition, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
         glUniform3fv(uColor, 1, color.data());
         glUniform1fv(uOpaque, 1, &opaque);
         glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-        glUseProgram(0);
-        glDisableVertexAttribArray(aPosition);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
     };
     void addPoint(Vector v) {
         LOG_DEBUG("Add line point at %f %f", v.x, v.y);
@@ -54,10 +85,18 @@ public:
             int d = ((i+2) >= points.size()) ? points.size()-1 : (i+2);
             drawSegment(points[a], points[b], points[c], points[d]);
         }
-        glGenBuffers(1, &vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        if (vertices.empty()) return;
+        bounds = Rect(vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y);
+        for (int i = 1; i < (int)vertices.size(); ++i) {
+            bounds.left = std::min(bounds.left, vertices[i].x);
+            bounds.right = std::max(bounds.right, vertices[i].x);
+            bounds.bottom = std::min(bounds.bottom, vertices[i].y);
+            bounds.top = std::max(bounds.top, vertices[i].y);
+        }
+        moved = true;
+        if (vbo == 0) glGenBuffers(1, &vbo);
+        GLState::getInstance()->bindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * 2 * sizeof(float), &vertices[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
     };
     void drawSegment(Vector p0, Vector p1, Vector p2, Vector p3) {
         // Skip if zero length.
@@ -90,11 +129,19 @@ public:
     float thickness;
     Vector color;
     float opaque;
+    int layer;
 private:
     std::vector<Vector> points;
     std::vector<Vector2> vertices;
+    // Place of the line on screen, and the one last drawn, if any.
+    Rect bounds;
+    Rect drawnBounds;
+    Vector drawnColor;
+    float drawnOpaque;
+    bool drawn, moved;
     GLuint shaderProgram;
-    GLuint aPosition, uProjection, uColor, uOpaque;
+    GLint aPosition;
+    GLuint uProjection, uColor, uOpaque;
 	GLuint vbo; // vertex buffer
 };
 
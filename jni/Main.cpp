@@ -3,6 +3,7 @@
 #define APP_TITLE "lithium"
 // #define DEBUG_MODE
 // #define FPS_COUNTER
+// #define RENDER_STATS
 #define SLOW_DOWN 1
 
 // Stuff for recieve log message.
@@ -127,6 +128,10 @@ void android_main(android_app* app) {
     AConfiguration_fromAssetManager(configuration, application->activity->assetManager);
     uiModeType = AConfiguration_getUiModeType(configuration);
     AConfiguration_delete(configuration);
+    // Frames are rendered 360 pixels wide and scaled to the screen.
+    GraphicsManager::getInstance()->setResolutionPolicy(ResolutionPolicy::FIXED);
+    // Weak devices lower the frame size down to 60% to hold 60 fps.
+    GraphicsManager::getInstance()->setDynamicResolution(0.6f, 1.0f, 60.0f);
     // Starts the game loop.
     EventLoop* eventLoop = new EventLoop();
     eventLoop->run(new Activity);
@@ -25,12 +25,12 @@ public:
     const float Y_SPEED_RANGE     = 6.0f;
     const float GRAVITY           = 0.1f;
     void update() {
-        sprite->angle += rotation;
-        sprite->scale = Vector2(size, size);
+        sprite->setAngle(sprite->getAngle() + rotation);
+        sprite->setScale(Vector2(size, size));
         // Calculate the new Y speed of the particle.
         speed.y = speed.y - GRAVITY;
         // Update the position of the particle by the speed it's moving at.
-        sprite->location = sprite->location + speed * TimeManager::getInstance()->getFrameElapsedTime() * 50.0f;
+        sprite->setLocation(sprite->getLocation() + speed * TimeManager::getInstance()->getFrameElapsedTime() * 50.0f);
         // Decrease the frames the particle will live for by 1.
         framesToLive--;
     };
@@ -55,6 +55,9 @@ public:
         }
         particles.clear();
     };
+    bool isIdle() {
+        return particles.empty();
+    };
     void update() {
         float renderWidth = (float)GraphicsManager::getInstance()->getRenderWidth();
         float renderHeight = (float)GraphicsManager::getInstance()->getRenderHeight();
@@ -79,7 +82,7 @@ public:
         // LOG_DEBUG("Create new particle.");
         Particle* particle = new Particle();
         particle->sprite = spriteBatch->registerSprite("textures/Particle.png", 47, 47);
-        particle->sprite->location = location;
+        particle->sprite->setLocation(location);
         particles.push_back(particle);
     };
     void emit(int count, Vector2 location) {
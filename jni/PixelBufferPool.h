@@ -0,0 +1,91 @@
+#ifndef __PIXELBUFFERPOOL_H__
+#define __PIXELBUFFERPOOL_H__
+
+/* Reuses the buffers images are decoded into */
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "Singleton.h"
+
+// Bytes of free buffers kept for the next images, larger ones are kept
+// first.
+const size_t PIXEL_BUFFER_POOL_BYTES = 8 * 1024 * 1024;
+
+// Decoded images are uploaded and released at once, so a few buffers
+// serve every texture while loading. Buffers are shared by the decoding
+// threads, the pool has to be created before them.
+class PixelBufferPool: public Singleton<PixelBufferPool> {
+public:
+    PixelBufferPool():
+        mutex(), freeBuffers(), freeBytes(0), usedBuffers() {
+        //
+    };
+    ~PixelBufferPool() {
+        trim();
+        for (std::map<unsigned char*, size_t>::iterator it = usedBuffers.begin(); it != usedBuffers.end(); ++it) {
+            delete[] it->first;
+        }
+        usedBuffers.clear();
+    };
+    // Smallest free buffer holding size bytes, or a new one.
+    unsigned char* acquire(size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int best = -1;
+        for (int i = 0; i < (int)freeBuffers.size(); ++i) {
+            if (freeBuffers[i].size >= size && (best < 0 || freeBuffers[i].size < freeBuffers[best].size)) best = i;
+        }
+        PixelBuffer buffer;
+        if (best >= 0) {
+            buffer = freeBuffers[best];
+            freeBuffers.erase(freeBuffers.begin() + best);
+            freeBytes -= buffer.size;
+        } else {
+            buffer.pixels = new unsigned char[size];
+            buffer.size = size;
+        }
+        usedBuffers[buffer.pixels] = buffer.size;
+        return buffer.pixels;
+    };
+    void release(unsigned char* pixels) {
+        if (pixels == NULL) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<unsigned char*, size_t>::iterator it = usedBuffers.find(pixels);
+        if (it == usedBuffers.end()) return;
+        PixelBuffer buffer = { it->first, it->second };
+        usedBuffers.erase(it);
+        freeBuffers.push_back(buffer);
+        freeBytes += buffer.size;
+        // Drops the smallest buffers.
+        while (freeBytes > PIXEL_BUFFER_POOL_BYTES) {
+            int smallest = 0;
+            for (int i = 1; i < (int)freeBuffers.size(); ++i) {
+                if (freeBuffers[i].size < freeBuffers[smallest].size) smallest = i;
+            }
+            freeBytes -= freeBuffers[smallest].size;
+            delete[] freeBuffers[smallest].pixels;
+            freeBuffers.erase(freeBuffers.begin() + smallest);
+        }
+    };
+    // Frees buffers which are not in use.
+    void trim() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::vector<PixelBuffer>::iterator it = freeBuffers.begin(); it < freeBuffers.end(); ++it) {
+            delete[] it->pixels;
+        }
+        freeBuffers.clear();
+        freeBytes = 0;
+    };
+private:
+    struct PixelBuffer {
+        unsigned char* pixels;
+        size_t size;
+    };
+    std::mutex mutex;
+    std::vector<PixelBuffer> freeBuffers;
+    size_t freeBytes;
+    std::map<unsigned char*, size_t> usedBuffers;
+};
+
+#endif // __PIXELBUFFERPOOL_H__
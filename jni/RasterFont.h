@@ -52,8 +52,8 @@ public:
                 if (q || (n >= lastTextLength)) {
                     Sprite* sprite = spriteBatch->registerSprite(path, width, height);
                     sprite->setFrame(text[n]);
-                    sprite->location = l;
-                    sprite->scale = scale;
+                    sprite->setLocation(l);
+                    sprite->setScale(scale);
                     // Add animation.
                     Tween* t1 = TweenManager::getInstance()->addTween(sprite, TweenType::SCALE_XY, 0.1f, Ease::Sinusoidal::InOut)
                         ->target(1.5f, 1.5f)->remove(true);
@@ -64,7 +64,7 @@ public:
                     t1->addChain(t2)->start();
                     if (q) sprites.at(n) = sprite;
                     else sprites.push_back(sprite);
-                } else sprites.at(n)->location.x = l.x;
+                } else sprites.at(n)->setLocation(Vector2(l.x, sprites.at(n)->getLocation().y));
             }
             // Delete tail.
             if (lastTextLength > textLength) {
@@ -102,10 +102,10 @@ public:
                 // Create new sprite.
                 Sprite* sprite = spriteBatch->registerSprite(path, width, height);
                 sprite->setFrame(text[n]);
-                sprite->location = l;
-                sprite->scale = Vector2(0.5f, 0.5f);
-                sprite->order = 5;
-                sprite->opaque = 0.0f;
+                sprite->setLocation(l);
+                sprite->setScale(Vector2(0.5f, 0.5f));
+                sprite->setOrder(5);
+                sprite->setOpaque(0.0f);
                 // Add animation.
                 Tween* t1 = TweenManager::getInstance()->addTween(sprite, TweenType::OPAQUE, 0.15f, Ease::Exponential::Out)
                     ->target(1.0f)->remove(true);
@@ -135,10 +135,10 @@ public:
                 // Create new sprite.
                 Sprite* sprite = spriteBatch->registerSprite(path, width, height);
                 sprite->setFrame(text[n]);
-                sprite->location = l;
-                sprite->scale = scale;
-                sprite->order = (text[n] == 43)? 1 : 3; // set "+" to back
-                sprite->opaque = 0.0f;
+                sprite->setLocation(l);
+                sprite->setScale(scale);
+                sprite->setOrder((text[n] == 43)? 1 : 3); // set "+" to back
+                sprite->setOpaque(0.0f);
                 // Add animation.
                 Tween* t1 = TweenManager::getInstance()->addTween(sprite, TweenType::OPAQUE, 0.15f, Ease::Sinusoidal::InOut)
                     ->target(1.0f)->remove(true);
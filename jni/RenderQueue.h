@@ -0,0 +1,578 @@
+#ifndef __RENDERQUEUE_H__
+#define __RENDERQUEUE_H__
+
+/* Collects draw commands of all graphics components for one frame */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "GLState.h"
+
+// Quads addressable with 16 bit indexes.
+const int MAX_QUADS = 65536 / 4;
+
+// Rendering counters, collected per frame.
+struct RenderStats {
+    int drawCalls;
+    int bytesUploaded;
+    int redundantStateCalls;
+    int culledSprites;
+    int layerRedraws;
+    int idleFrames;
+    int redrawnPixels;
+};
+
+struct SpriteVertex {
+    // Depth is written by the render queue.
+    GLfloat x, y, z, u, v;
+    GLubyte r, g, b, a;
+    // Texture unit sampled, written by the render queue.
+    GLubyte slot;
+};
+
+// Shader drawing quads made of sprite vertices, commands using the same
+// program id share their draw calls. Programs with several texture slots
+// sample the unit given by the vertex slot, so one draw spans textures.
+struct RenderProgram {
+    GLuint programId;
+    GLint aPosition, aTexture, aColor, aSlot;
+    GLint uProjection, uTexture;
+    int textureSlots;
+};
+
+enum {
+    BLEND_NONE          = 0,
+    BLEND_ALPHA         = 1,
+    // Composites cached layers, whose color is already multiplied by alpha.
+    BLEND_PREMULTIPLIED = 2
+};
+
+// Renders its own geometry when the queue reaches its command.
+class RenderCallback {
+public:
+    virtual void render(void) = 0;
+    virtual ~RenderCallback(void) {};
+};
+
+struct RenderCommand {
+    // Layer in the high bits, submission order in the low bits.
+    uint64_t key;
+    int layer;
+    const RenderProgram* program;
+    GLuint textureId;
+    int blend;
+    int firstQuad, quadCount;
+    RenderCallback* callback;
+};
+
+// Commands merged into one draw call.
+struct RenderDraw {
+    const RenderProgram* program;
+    int blend;
+    GLuint textures[MAX_TEXTURE_UNITS];
+    int textureCount;
+    int firstQuad, quadCount;
+    RenderCallback* callback;
+    // Drawn in the solid pass, before the ordered one.
+    bool solidPass;
+};
+
+// Framebuffer a frame is drawn into, with its size in pixels and the
+// frame size in render coordinates. Scissor test limits the frame to its
+// damaged part.
+struct RenderTarget {
+    GLuint frameBuffer;
+    int width, height;
+    int renderWidth, renderHeight;
+    bool scissorTest;
+};
+
+// Layer rendered into its own target, which is drawn as a single quad
+// until the layer is invalidated.
+struct RenderLayer {
+    int layer;
+    GLuint frameBuffer, texture;
+    int width, height;
+    bool dirty;
+    // Target has no transparent pixel, it is composited without blending.
+    bool opaque;
+};
+
+// Draws of a dirty cached layer.
+struct LayerPass {
+    int layerIndex;
+    int firstCommand, commandCount;
+    int firstDraw, drawCount;
+};
+
+class RenderQueue {
+public:
+    RenderQueue():
+        commands(),
+        frameCommands(),
+        layerCommands(),
+        quadVertices(),
+        sortedVertices(),
+        draws(),
+        layerDraws(),
+        layers(),
+        layerPasses(),
+        depthTest(false),
+        vertexBuffers(), vertexBufferSize(), currentVertexBuffer(0) {
+        //
+    };
+    // Starts a new frame.
+    void clear() {
+        commands.clear();
+        quadVertices.clear();
+    };
+    // Returns room for quad vertices to be filled by the caller, valid
+    // until the next submission. Follows up a command with the same
+    // state, so the batch grows instead of the command list.
+    SpriteVertex* submitQuads(int layer, const RenderProgram* program, GLuint textureId, int blend, int quadCount) {
+        int firstQuad = quadVertices.size() / 4;
+        quadVertices.resize(quadVertices.size() + quadCount * 4);
+        if (!commands.empty()) {
+            RenderCommand& last = commands.back();
+            if (last.callback == NULL && last.layer == layer && last.program->programId == program->programId
+                    && last.textureId == textureId && last.blend == blend
+                    && last.firstQuad + last.quadCount == firstQuad) {
+                last.quadCount += quadCount;
+                return quadVertices.data() + firstQuad * 4;
+            }
+        }
+        RenderCommand command = { makeKey(layer), layer, program, textureId, blend, firstQuad, quadCount, NULL };
+        commands.push_back(command);
+        return quadVertices.data() + firstQuad * 4;
+    };
+    void submitCallback(int layer, RenderCallback* callback) {
+        RenderCommand command = { makeKey(layer), layer, NULL, 0, BLEND_NONE, 0, 0, callback };
+        commands.push_back(command);
+    };
+    // Commands of a cached layer are rendered into a target of the frame
+    // size, which is reused by the next frames until the layer is invalidated.
+    void setLayerCached(int layer, bool cached) {
+        int index = findLayer(layer);
+        if (cached && index < 0) {
+            RenderLayer renderLayer = { layer, 0, 0, 0, 0, true, false };
+            layers.push_back(renderLayer);
+        } else if (!cached && index >= 0) {
+            releaseTarget(layers[index]);
+            layers.erase(layers.begin() + index);
+        }
+    };
+    bool isLayerCached(int layer) {
+        return findLayer(layer) >= 0;
+    };
+    // Clean cached layers are composited from their target, their
+    // commands are not needed.
+    bool isLayerDirty(int layer) {
+        int index = findLayer(layer);
+        return index < 0 || layers[index].dirty || layers[index].texture == 0;
+    };
+    // Called when something drawn on the layer changed.
+    void invalidateLayer(int layer) {
+        int index = findLayer(layer);
+        if (index >= 0) layers[index].dirty = true;
+    };
+    void invalidateLayers() {
+        for (std::vector<RenderLayer>::iterator it = layers.begin(); it < layers.end(); ++it) {
+            it->dirty = true;
+        }
+    };
+    // Releases layer targets and forgets cached layers.
+    void clearLayers() {
+        for (std::vector<RenderLayer>::iterator it = layers.begin(); it < layers.end(); ++it) {
+            releaseTarget(*it);
+        }
+        layers.clear();
+    };
+    // Sorts commands by layer and draws them, neighbours sharing the same
+    // state are merged into one draw call whatever component sent them.
+    // Unblended commands are drawn first and front to back, so that depth
+    // test rejects what they hide, then the others in painter's order.
+    // Dirty cached layers are rendered into their targets beforehand.
+    void flush(const GLfloat* projection, GLuint indexBuffer, const RenderTarget& target, RenderStats& stats) {
+        if (commands.empty()) return;
+        std::vector<SpriteVertex>* vertices = &quadVertices;
+        if (!isSorted()) {
+            std::sort(commands.begin(), commands.end(), sort());
+            // Quads follow the command order, so merged commands stay contiguous.
+            sortedVertices.resize(quadVertices.size());
+            int quad = 0;
+            for (std::vector<RenderCommand>::iterator it = commands.begin(); it < commands.end(); ++it) {
+                if (it->callback != NULL) continue;
+                memcpy(&sortedVertices[quad * 4], &quadVertices[it->firstQuad * 4], it->quadCount * 4 * sizeof(SpriteVertex));
+                it->firstQuad = quad;
+                quad += it->quadCount;
+            }
+            vertices = &sortedVertices;
+        }
+        layerPasses.clear();
+        if (!layers.empty()) composeLayers(*vertices, target);
+        // Layers have no depth buffer and are drawn in painter's order.
+        layerDraws.clear();
+        for (std::vector<LayerPass>::iterator pass = layerPasses.begin(); pass < layerPasses.end(); ++pass) {
+            std::vector<RenderCommand>::iterator first = layerCommands.begin() + pass->firstCommand;
+            pass->firstDraw = layerDraws.size();
+            planDraws(first, first + pass->commandCount, *vertices, layerDraws, false);
+            pass->drawCount = layerDraws.size() - pass->firstDraw;
+        }
+        draws.clear();
+        depthTest = planDraws(commands.begin(), commands.end(), *vertices, draws, true);
+        if (depthTest) setDepth(*vertices);
+        if (!vertices->empty()) upload(*vertices, stats);
+        // State changes go through the cache, which skips repeated ones.
+        GLState* state = GLState::getInstance();
+        const RenderProgram* currentProgram = NULL;
+        if (!layerPasses.empty()) {
+            // Layers are rendered whole.
+            state->setScissorTest(false);
+            state->setDepthTest(false);
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            for (std::vector<LayerPass>::iterator pass = layerPasses.begin(); pass < layerPasses.end(); ++pass) {
+                RenderLayer& renderLayer = layers[pass->layerIndex];
+                state->bindFramebuffer(renderLayer.frameBuffer);
+                glClear(GL_COLOR_BUFFER_BIT);
+                std::vector<RenderDraw>::iterator first = layerDraws.begin() + pass->firstDraw;
+                currentProgram = renderOrdered(first, first + pass->drawCount, currentProgram, projection, indexBuffer, stats);
+                renderLayer.dirty = false;
+                stats.layerRedraws++;
+            }
+            state->bindFramebuffer(target.frameBuffer);
+            state->setScissorTest(target.scissorTest);
+        }
+        state->setDepthTest(depthTest);
+        state->setDepthMask(depthTest);
+        if (depthTest) {
+            for (std::vector<RenderDraw>::reverse_iterator draw = draws.rbegin(); draw < draws.rend(); ++draw) {
+                if (draw->solidPass) currentProgram = render(&*draw, currentProgram, projection, indexBuffer, stats);
+            }
+            state->setDepthMask(false);
+        }
+        renderOrdered(draws.begin(), draws.end(), currentProgram, projection, indexBuffer, stats);
+    };
+    // Buffers and layer targets are recreated with the OpenGL context.
+    void releaseBuffers() {
+        for (std::vector<RenderLayer>::iterator it = layers.begin(); it < layers.end(); ++it) {
+            releaseTarget(*it);
+        }
+        if (vertexBuffers[0] != 0) {
+            GLState::getInstance()->deleteBuffers(VERTEX_BUFFER_COUNT, vertexBuffers);
+        }
+        for (int i = 0; i < VERTEX_BUFFER_COUNT; ++i) {
+            vertexBuffers[i] = 0;
+            vertexBufferSize[i] = 0;
+        }
+    };
+private:
+    // Sort order.
+    struct sort {
+        bool operator() (const RenderCommand& a, const RenderCommand& b) const {
+            return a.key < b.key;
+        }
+    };
+    uint64_t makeKey(int layer) {
+        // Flips sign bit so negative layers come first.
+        return (uint64_t)((uint32_t)layer ^ 0x80000000u) << 32 | (uint32_t)commands.size();
+    };
+    int findLayer(int layer) {
+        for (int i = 0; i < (int)layers.size(); ++i) {
+            if (layers[i].layer == layer) return i;
+        }
+        return -1;
+    };
+    // Creates the texture and framebuffer a layer is rendered into.
+    status createTarget(RenderLayer& renderLayer, int width, int height) {
+        renderLayer.width = width;
+        renderLayer.height = height;
+        GLState* state = GLState::getInstance();
+        glGenTextures(1, &renderLayer.texture);
+        state->bindTexture(0, renderLayer.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // Layers are composited over others, so alpha is kept.
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenFramebuffers(1, &renderLayer.frameBuffer);
+        state->bindFramebuffer(renderLayer.frameBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderLayer.texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) goto ERROR;
+        renderLayer.dirty = true;
+        return STATUS_OK;
+ERROR:
+        LOG_ERROR("Error creating target of layer %d.", renderLayer.layer);
+        releaseTarget(renderLayer);
+        return STATUS_ERROR;
+    };
+    void releaseTarget(RenderLayer& renderLayer) {
+        if (renderLayer.frameBuffer != 0) GLState::getInstance()->deleteFramebuffer(renderLayer.frameBuffer);
+        if (renderLayer.texture != 0) GLState::getInstance()->deleteTexture(renderLayer.texture);
+        renderLayer.frameBuffer = 0;
+        renderLayer.texture = 0;
+        renderLayer.dirty = true;
+    };
+    // Replaces commands of each cached layer by one quad showing its
+    // target. Commands of dirty layers are kept aside to be rendered into
+    // the target first, clean layers only send a command without quads.
+    // Layers only made of callbacks have no program to draw the quad and
+    // stay uncached. Opaque layers are composited in the solid pass.
+    void composeLayers(std::vector<SpriteVertex>& vertices, const RenderTarget& target) {
+        frameCommands.clear();
+        layerCommands.clear();
+        // Targets follow the frame size.
+        for (int i = 0; i < (int)layers.size(); ++i) {
+            RenderLayer& renderLayer = layers[i];
+            if (renderLayer.texture != 0 && (renderLayer.width != target.width || renderLayer.height != target.height)) {
+                releaseTarget(renderLayer);
+            }
+            if (renderLayer.texture != 0 || createTarget(renderLayer, target.width, target.height) == STATUS_OK) continue;
+            layers.erase(layers.begin() + i--);
+        }
+        int commandCount = commands.size();
+        int first = 0;
+        while (first < commandCount) {
+            int layer = commands[first].layer;
+            int last = first + 1;
+            while (last < commandCount && commands[last].layer == layer) ++last;
+            const RenderProgram* program = NULL;
+            for (int i = first; i < last && program == NULL; ++i) program = commands[i].program;
+            int layerIndex = findLayer(layer);
+            if (layerIndex < 0 || program == NULL) {
+                for (int i = first; i < last; ++i) {
+                    if (commands[i].callback != NULL || commands[i].quadCount > 0) frameCommands.push_back(commands[i]);
+                }
+                first = last;
+                continue;
+            }
+            RenderLayer& renderLayer = layers[layerIndex];
+            if (renderLayer.dirty) {
+                LayerPass pass = { layerIndex, (int)layerCommands.size(), last - first, 0, 0 };
+                layerPasses.push_back(pass);
+                layerCommands.insert(layerCommands.end(), commands.begin() + first, commands.begin() + last);
+                renderLayer.opaque = coversFrame(commands.begin() + first, commands.begin() + last, vertices, target);
+            }
+            // Quad covers the frame, corners in sprite order.
+            int quad = vertices.size() / 4;
+            vertices.resize(vertices.size() + 4);
+            const GLfloat corners[4][2] = { { 0.0f, 0.0f }, { 0.0f, 1.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f } };
+            for (int i = 0; i < 4; ++i) {
+                SpriteVertex vertex = { corners[i][0] * target.renderWidth, corners[i][1] * target.renderHeight, 0.0f,
+                    corners[i][0], corners[i][1], 255, 255, 255, 255, 0 };
+                vertices[quad * 4 + i] = vertex;
+            }
+            int blend = renderLayer.opaque ? BLEND_NONE : BLEND_PREMULTIPLIED;
+            RenderCommand command = { commands[first].key, layer, program, renderLayer.texture, blend, quad, 1, NULL };
+            frameCommands.push_back(command);
+            first = last;
+        }
+        commands.swap(frameCommands);
+    };
+    // True when an unblended quad of the commands fills the frame, then
+    // the layer target has no transparent pixel.
+    static bool coversFrame(std::vector<RenderCommand>::iterator first, std::vector<RenderCommand>::iterator last,
+            const std::vector<SpriteVertex>& vertices, const RenderTarget& target) {
+        for (; first < last; ++first) {
+            if (first->callback != NULL || first->blend != BLEND_NONE) continue;
+            for (int quad = first->firstQuad; quad < first->firstQuad + first->quadCount; ++quad) {
+                const SpriteVertex* corners = &vertices[quad * 4];
+                float left = corners[0].x, right = corners[0].x;
+                float bottom = corners[0].y, top = corners[0].y;
+                for (int i = 1; i < 4; ++i) {
+                    left = std::min(left, corners[i].x);
+                    right = std::max(right, corners[i].x);
+                    bottom = std::min(bottom, corners[i].y);
+                    top = std::max(top, corners[i].y);
+                }
+                if (left > 0.0f || bottom > 0.0f || right < target.renderWidth || top < target.renderHeight) continue;
+                // Rotated quads do not fill their bounds.
+                bool aligned = true;
+                for (int i = 0; i < 4; ++i) {
+                    if ((corners[i].x != left && corners[i].x != right) || (corners[i].y != bottom && corners[i].y != top)) aligned = false;
+                }
+                if (aligned) return true;
+            }
+        }
+        return false;
+    };
+    bool isSorted() {
+        for (int i = 1; i < (int)commands.size(); ++i) {
+            if (commands[i].key < commands[i - 1].key) return false;
+        }
+        return true;
+    };
+    // Streams vertices into the next buffer of the ring, so the
+    // driver never waits for a buffer still used by a previous frame.
+    void upload(const std::vector<SpriteVertex>& vertices, RenderStats& stats) {
+        if (vertexBuffers[0] == 0) glGenBuffers(VERTEX_BUFFER_COUNT, vertexBuffers);
+        currentVertexBuffer = (currentVertexBuffer + 1) % VERTEX_BUFFER_COUNT;
+        int vertexDataSize = vertices.size() * sizeof(SpriteVertex);
+        GLState::getInstance()->bindBuffer(GL_ARRAY_BUFFER, vertexBuffers[currentVertexBuffer]);
+        if (vertexBufferSize[currentVertexBuffer] < vertexDataSize) {
+            // Grows by doubling, so the store is rarely reallocated.
+            int size = std::max(vertexBufferSize[currentVertexBuffer], MIN_BUFFER_SIZE);
+            while (size < vertexDataSize) size *= 2;
+            vertexBufferSize[currentVertexBuffer] = size;
+            glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertexDataSize, &vertices[0]);
+        stats.bytesUploaded += vertexDataSize;
+    };
+    // Draws merged commands, returns the program in use.
+    const RenderProgram* render(const RenderDraw* draw, const RenderProgram* currentProgram,
+            const GLfloat* projection, GLuint indexBuffer, RenderStats& stats) {
+        GLState* state = GLState::getInstance();
+        const RenderProgram* program = draw->program;
+        state->bindBuffer(GL_ARRAY_BUFFER, vertexBuffers[currentVertexBuffer]);
+        state->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        if (currentProgram == NULL || program->programId != currentProgram->programId) {
+            currentProgram = program;
+            state->useProgram(program->programId);
+            glUniformMatrix4fv(program->uProjection, 1, GL_FALSE, projection);
+            // Sampler of each slot reads its own texture unit.
+            static const GLint units[MAX_TEXTURE_UNITS] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+            glUniform1iv(program->uTexture, program->textureSlots, units);
+        }
+        GLuint mask = (1 << program->aPosition) | (1 << program->aTexture) | (1 << program->aColor);
+        if (program->aSlot >= 0) mask |= 1 << program->aSlot;
+        state->setVertexAttribArrays(mask);
+        for (int unit = 0; unit < draw->textureCount; ++unit) {
+            state->bindTexture(unit, draw->textures[unit]);
+        }
+        // Alpha accumulates coverage, as cached layers are composited later.
+        state->setBlend(draw->blend != BLEND_NONE);
+        if (draw->blend == BLEND_ALPHA) {
+            state->blendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        } else if (draw->blend == BLEND_PREMULTIPLIED) {
+            state->blendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        }
+        // Index buffer addresses MAX_QUADS quads, so vertex pointers
+        // are moved to the first quad of each draw.
+        int firstQuad = draw->firstQuad;
+        int quadCount = draw->quadCount;
+        while (quadCount > 0) {
+            int count = std::min(quadCount, MAX_QUADS);
+            setVertexPointers(program, firstQuad);
+            glDrawElements(GL_TRIANGLES, count * 6, GL_UNSIGNED_SHORT, (GLvoid*) 0);
+            stats.drawCalls++;
+            firstQuad += count;
+            quadCount -= count;
+        }
+        return currentProgram;
+    };
+    // Draws in order skipping the solid pass, returns the program in use.
+    const RenderProgram* renderOrdered(std::vector<RenderDraw>::iterator first, std::vector<RenderDraw>::iterator last,
+            const RenderProgram* currentProgram, const GLfloat* projection, GLuint indexBuffer, RenderStats& stats) {
+        for (std::vector<RenderDraw>::iterator draw = first; draw < last; ++draw) {
+            if (draw->solidPass) continue;
+            if (draw->callback != NULL) {
+                // Callbacks draw over all solid draws, which come before
+                // them. Callback may use another program, uniforms are set again.
+                GLState::getInstance()->setDepthTest(false);
+                draw->callback->render();
+                currentProgram = NULL;
+                continue;
+            }
+            currentProgram = render(&*draw, currentProgram, projection, indexBuffer, stats);
+        }
+        return currentProgram;
+    };
+    // Merges following commands of the same program and blend into draws,
+    // as long as their textures fit into the program texture slots. Slots
+    // are written into the vertices before upload. When allowed, unblended
+    // draws before any callback go to the solid pass. Returns whether
+    // there is a solid pass.
+    bool planDraws(std::vector<RenderCommand>::iterator first, std::vector<RenderCommand>::iterator last,
+            std::vector<SpriteVertex>& vertices, std::vector<RenderDraw>& planned, bool allowSolidPass) {
+        bool hasSolidPass = false;
+        bool afterCallback = false;
+        for (std::vector<RenderCommand>::iterator command = first; command < last; ++command) {
+            if (command->callback != NULL) {
+                RenderDraw draw = { NULL, BLEND_NONE, {}, 0, 0, 0, command->callback, false };
+                planned.push_back(draw);
+                afterCallback = true;
+                continue;
+            }
+            const RenderProgram* program = command->program;
+            RenderDraw* draw = planned.empty() ? NULL : &planned.back();
+            if (draw != NULL && (draw->callback != NULL || draw->program->programId != program->programId
+                    || draw->blend != command->blend || draw->firstQuad + draw->quadCount != command->firstQuad)) {
+                draw = NULL;
+            }
+            int slot = -1;
+            if (draw != NULL) {
+                for (int unit = 0; unit < draw->textureCount; ++unit) {
+                    if (draw->textures[unit] == command->textureId) slot = unit;
+                }
+                if (slot < 0 && draw->textureCount < program->textureSlots) {
+                    slot = draw->textureCount++;
+                    draw->textures[slot] = command->textureId;
+                }
+            }
+            if (slot < 0) {
+                // Textures do not fit, a new draw starts.
+                bool solidPass = (allowSolidPass && command->blend == BLEND_NONE && !afterCallback);
+                RenderDraw newDraw = { program, command->blend, { command->textureId }, 1, command->firstQuad, 0, NULL, solidPass };
+                planned.push_back(newDraw);
+                draw = &planned.back();
+                slot = 0;
+                hasSolidPass |= solidPass;
+            }
+            draw->quadCount += command->quadCount;
+            if (program->textureSlots > 1) {
+                SpriteVertex* vertex = &vertices[command->firstQuad * 4];
+                for (int i = command->quadCount * 4; i > 0; --i, ++vertex) vertex->slot = slot;
+            }
+        }
+        return hasSolidPass;
+    };
+    // Later quads of the frame commands are nearer. Projection flips z,
+    // so depth decreases from 1 to -1 in draw order.
+    void setDepth(std::vector<SpriteVertex>& vertices) {
+        int quadCount = 0;
+        for (std::vector<RenderCommand>::iterator command = commands.begin(); command < commands.end(); ++command) {
+            quadCount += command->quadCount;
+        }
+        float depthStep = 2.0f / (quadCount + 1);
+        int quad = 0;
+        for (std::vector<RenderCommand>::iterator command = commands.begin(); command < commands.end(); ++command) {
+            SpriteVertex* vertex = &vertices[command->firstQuad * 4];
+            for (int i = 0; i < command->quadCount; ++i, vertex += 4) {
+                float z = depthStep * (++quad) - 1.0f;
+                vertex[0].z = vertex[1].z = vertex[2].z = vertex[3].z = z;
+            }
+        }
+    };
+    void setVertexPointers(const RenderProgram* program, int firstQuad) {
+        size_t offset = firstQuad * 4 * sizeof(SpriteVertex);
+        glVertexAttribPointer(program->aPosition, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (GLvoid*) (offset + offsetof(SpriteVertex, x)));
+        glVertexAttribPointer(program->aTexture, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (GLvoid*) (offset + offsetof(SpriteVertex, u)));
+        glVertexAttribPointer(program->aColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (GLvoid*) (offset + offsetof(SpriteVertex, r)));
+        if (program->aSlot >= 0) {
+            glVertexAttribPointer(program->aSlot, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(SpriteVertex), (GLvoid*) (offset + offsetof(SpriteVertex, slot)));
+        }
+    };
+    static const int VERTEX_BUFFER_COUNT = 3;
+    static const int MIN_BUFFER_SIZE = 64 * 4 * sizeof(SpriteVertex);
+    std::vector<RenderCommand> commands;
+    // Commands left once cached layers are composed, and commands of dirty layers.
+    std::vector<RenderCommand> frameCommands;
+    std::vector<RenderCommand> layerCommands;
+    // Quads in submission order, and in command order once sorted.
+    std::vector<SpriteVertex> quadVertices;
+    std::vector<SpriteVertex> sortedVertices;
+    std::vector<RenderDraw> draws;
+    std::vector<RenderDraw> layerDraws;
+    std::vector<RenderLayer> layers;
+    std::vector<LayerPass> layerPasses;
+    // Set when the frame has a solid pass.
+    bool depthTest;
+    GLuint vertexBuffers[VERTEX_BUFFER_COUNT];
+    int vertexBufferSize[VERTEX_BUFFER_COUNT];
+    int currentVertexBuffer;
+};
+
+#endif // __RENDERQUEUE_H__
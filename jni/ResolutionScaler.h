@@ -0,0 +1,90 @@
+#ifndef __RESOLUTIONSCALER_H__
+#define __RESOLUTIONSCALER_H__
+
+/* Scales the frame resolution to hold a frame time budget */
+
+// Weight of the last frame in measures.
+const float RESOLUTION_SMOOTHING  = 0.1f;
+const float RESOLUTION_SCALE_STEP = 0.1f;
+// Frames between two scale changes.
+const int RESOLUTION_COOLDOWN     = 30;
+
+class ResolutionScaler {
+public:
+    ResolutionScaler():
+        minScale(1.0f), maxScale(1.0f), scale(1.0f),
+        frameBudget(1.0f / 60.0f),
+        frameTime(0.0f), renderTime(0.0f), swapTime(0.0f),
+        samples(0), cooldown(0) {
+        //
+    };
+    // Scale moves between the bounds, as a fraction of the frame size
+    // chosen by the resolution policy. Equal bounds disable scaling.
+    void configure(float minScale, float maxScale, float framesPerSecond) {
+        this->minScale = CLAMP(minScale, 0.25f, 1.0f);
+        this->maxScale = CLAMP(maxScale, this->minScale, 1.0f);
+        frameBudget = 1.0f / framesPerSecond;
+        scale = this->maxScale;
+        reset();
+    };
+    bool isEnabled() {
+        return minScale < maxScale;
+    };
+    float getScale() {
+        return scale;
+    };
+    float getMaxScale() {
+        return maxScale;
+    };
+    // Forgets measures, they do not hold after a context change.
+    void reset() {
+        samples = 0;
+        cooldown = RESOLUTION_COOLDOWN;
+    };
+    // Takes the measures of a frame, returns true when the scale changed.
+    // Frame time is between two frames, render time is spent issuing GL
+    // commands and swap time is spent in eglSwapBuffers waiting for the GPU.
+    bool update(float frameElapsed, float renderElapsed, float swapElapsed) {
+        if (!isEnabled()) return false;
+        // First frame after a reset spans the pause, it is not measured.
+        if (samples++ == 0) return false;
+        // Smoothes measures, so single slow frames do not move the scale.
+        if (samples == 2) {
+            frameTime = frameElapsed;
+            renderTime = renderElapsed;
+            swapTime = swapElapsed;
+        } else {
+            frameTime += (frameElapsed - frameTime) * RESOLUTION_SMOOTHING;
+            renderTime += (renderElapsed - renderTime) * RESOLUTION_SMOOTHING;
+            swapTime += (swapElapsed - swapTime) * RESOLUTION_SMOOTHING;
+        }
+        // Waits for the last change to show in the measures.
+        if (cooldown > 0) {
+            --cooldown;
+            return false;
+        }
+        float newScale = scale;
+        if (frameTime > frameBudget * 1.05f) {
+            // Only frames waiting for the GPU get faster with less pixels.
+            if (swapTime > renderTime) newScale -= RESOLUTION_SCALE_STEP;
+        } else if (frameTime < frameBudget * 0.8f) {
+            // Pixel cost grows with the square of the scale, the margin
+            // keeps the next step under budget.
+            newScale += RESOLUTION_SCALE_STEP;
+        }
+        newScale = CLAMP(newScale, minScale, maxScale);
+        if (newScale == scale) return false;
+        scale = newScale;
+        cooldown = RESOLUTION_COOLDOWN;
+        return true;
+    };
+private:
+    float minScale, maxScale;
+    float scale;
+    float frameBudget;
+    float frameTime, renderTime, swapTime;
+    int samples;
+    int cooldown;
+};
+
+#endif // __RESOLUTIONSCALER_H__
@@ -27,6 +27,12 @@ public:
         asset = AAssetManager_open(assetManager, filePath, AASSET_MODE_UNKNOWN);
         return (asset != NULL) ? STATUS_OK : STATUS_ERROR;
     };
+    // Maps the whole asset into memory, valid until close. Assets stored
+    // uncompressed in the package, as PNG images are, are not copied.
+    const void* map() {
+        if (asset == NULL) asset = AAssetManager_open(assetManager, filePath, AASSET_MODE_BUFFER);
+        return (asset != NULL) ? AAsset_getBuffer(asset) : NULL;
+    };
     const char* getPath() {
         return filePath;
     };
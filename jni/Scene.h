@@ -22,7 +22,7 @@ public:
     virtual void update() {};
     void setSprite(Sprite* sprite, Vector2 location) {
         this->sprite = sprite;
-        sprite->location = location;
+        sprite->setLocation(location);
     };
     virtual void onDead(Tweenable* t) {
         dead = true;
@@ -152,16 +152,16 @@ public:
     };
     void setSliderHandle(const char* path, int width, int height, int position) {
         sliderHandle = spriteBatch->registerSprite(path, width, height);
-        int x = sprite->location.x - sprite->getWidth() / 2;
-        float minPosition = sprite->location.x - sprite->getWidth() / 2 + sliderHandle->getWidth() / 4;
-        sliderHandle->location = Vector2(minPosition, sprite->location.y);
+        int x = sprite->getLocation().x - sprite->getWidth() / 2;
+        float minPosition = sprite->getLocation().x - sprite->getWidth() / 2 + sliderHandle->getWidth() / 4;
+        sliderHandle->setLocation(Vector2(minPosition, sprite->getLocation().y));
     };
     void setPosition(int precent) {
         this->precent = (int)CLAMP(precent, 0.0f, 100.0f);
-        float minPosition = sprite->location.x - sprite->getWidth() / 2 + sliderHandle->getWidth() / 4;
-        float maxPosition = sprite->location.x + sprite->getWidth() / 2 - sliderHandle->getWidth() / 4;
+        float minPosition = sprite->getLocation().x - sprite->getWidth() / 2 + sliderHandle->getWidth() / 4;
+        float maxPosition = sprite->getLocation().x + sprite->getWidth() / 2 - sliderHandle->getWidth() / 4;
         float position = (maxPosition - minPosition) * precent / 100.0f + minPosition;
-        sliderHandle->location = Vector2(position, sprite->location.y);
+        sliderHandle->setLocation(Vector2(position, sprite->getLocation().y));
     };
     void touchEvent(Touch::TouchEvent event, int x, int y, size_t pointerId) {
         switch (event) {
@@ -176,10 +176,10 @@ public:
     int gestureTapEvent(int x, int y) {
         Vector2 point = GraphicsManager::getInstance()->screenToRender(x, y);
         if (sprite->pointInSprite(point.x, point.y)) {
-            float minPosition = sprite->location.x - sprite->getWidth() / 2 + sliderHandle->getWidth() / 4;
-            float maxPosition = sprite->location.x + sprite->getWidth() / 2 - sliderHandle->getWidth() / 4;
+            float minPosition = sprite->getLocation().x - sprite->getWidth() / 2 + sliderHandle->getWidth() / 4;
+            float maxPosition = sprite->getLocation().x + sprite->getWidth() / 2 - sliderHandle->getWidth() / 4;
             if (point.x >= minPosition && point.x <= maxPosition) {
-                sliderHandle->location = Vector2(point.x, sprite->location.y);
+                sliderHandle->setLocation(Vector2(point.x, sprite->getLocation().y));
                 float position = CLAMP((float)(point.x - minPosition) / (maxPosition - minPosition), 0.0f, 1.0f);
                 int state = (int)CLAMP((float)(point.x - minPosition) / (maxPosition - minPosition) * 100.0f, 0.0f, 100.0f);
                 changed = (state == precent);
@@ -235,10 +235,14 @@ private:
     std::function<void()> clickFunction;
 };
 
+// Layer of static images, under the sprite batch layer.
+const int STATIC_LAYER = -1;
+
 // Base Scene.
 class Scene: public InputListener {
 public:
     Scene():
+        staticBatch(NULL),
         created(false) {
         LOG_DEBUG("Create scene.");
     }
@@ -282,11 +286,38 @@ public:
         widgets.push_back(background);
         return background;
     };
+    // Packs scene images into the texture atlas.
+    void registerAtlasImages(const char* const* paths, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            GraphicsManager::getInstance()->registerAtlasImage(paths[i]);
+        }
+    };
+    template<size_t count> void registerAtlasImages(const char* const (&paths)[count]) {
+        registerAtlasImages(paths, count);
+    };
+    // Static images go to a batch of the cached static layer, which is
+    // only redrawn when one of them changes. They are backdrops covering
+    // the screen, their few translucent texels are drawn opaque so that
+    // the layer is composited without blending.
+    Background* addStaticBackground(const char* path, int width, int height, Vector2 location) {
+        LOG_INFO("Creating new static 'Background' widget.");
+        if (staticBatch == NULL) {
+            staticBatch = new SpriteBatch();
+            staticBatch->setLayer(STATIC_LAYER);
+            GraphicsManager::getInstance()->setLayerCached(STATIC_LAYER, true);
+        }
+        Background* background = new Background();
+        background->setSprite(staticBatch->registerSprite(path, width, height), location);
+        background->sprite->setSolid(true);
+        background->spriteBatch = staticBatch;
+        widgets.push_back(background);
+        return background;
+    };
     Background* addAnimation(const char* path, int width, int height, Vector2 location, int frames, float duration, float delay = 0.0f) {
         LOG_DEBUG("Creating new 'Animation' widget.");
         Background* animation = new Background();
         animation->setSprite(spriteBatch->registerSprite(path, width, height), location);
-        animation->sprite->order = 1;
+        animation->sprite->setOrder(1);
         animation->spriteBatch = spriteBatch;
         TweenManager::getInstance()->addTween(animation->sprite, TweenType::FRAME, duration, Ease::Linear)->target(frames)->remove(true)
             ->onComplete(std::bind(&Widget::onDead, animation, std::placeholders::_1))->start(delay);
@@ -297,9 +328,9 @@ public:
         LOG_DEBUG("Creating new 'BonusText' widget.");
         Background* bonusText = new Background();
         bonusText->setSprite(spriteBatch->registerSprite(path, width, height), location);
-        bonusText->sprite->order = 5;
-        bonusText->sprite->scale = Vector2(0.5f, 0.5f);
-        bonusText->sprite->opaque = 0.0f;
+        bonusText->sprite->setOrder(5);
+        bonusText->sprite->setScale(Vector2(0.5f, 0.5f));
+        bonusText->sprite->setOpaque(0.0f);
         bonusText->sprite->setFrame(frame);
         Tween* t1 = TweenManager::getInstance()->addTween(bonusText->sprite, TweenType::OPAQUE, 0.25f, Ease::Sinusoidal::InOut)->target(1.0f)->remove(true)->start();
         Tween* t2 = TweenManager::getInstance()->addTween(bonusText->sprite, TweenType::SCALE_XY, 0.25f, Ease::Back::Out)->target(1.0f, 1.0f)->remove(true);
@@ -318,9 +349,9 @@ public:
         for (int n = 0; n < frames; n++) {
             Background* superText = new Background();
             superText->setSprite(spriteBatch->registerSprite(path, width, height), location);
-            superText->sprite->order = 5;
-            superText->sprite->scale = Vector2(0.3f, 0.3f);
-            superText->sprite->opaque = 0.0f;
+            superText->sprite->setOrder(5);
+            superText->sprite->setScale(Vector2(0.3f, 0.3f));
+            superText->sprite->setOpaque(0.0f);
             superText->sprite->setFrame(n);
             Tween* t1 = TweenManager::getInstance()->addTween(superText->sprite, TweenType::OPAQUE, 1.0f, Ease::Exponential::Out)
                 ->target(1.0f)->remove(true);
@@ -347,7 +378,7 @@ public:
             if ((*it)->dead) {
                 // Delete dead widget.
                 LOG_DEBUG("Delete dead widget.");
-                spriteBatch->unregisterSprite((*it)->sprite);
+                (*it)->spriteBatch->unregisterSprite((*it)->sprite);
                 widgets.erase(std::remove(widgets.begin(), widgets.end(), *it), widgets.end());
             } else (*it)->update();
         }
@@ -355,7 +386,11 @@ public:
     virtual status start(void) = 0;
     virtual void pause(void) {};
     virtual void resume(void) {};
+    // Scenes animating apart from tweens keep the event loop running.
+    virtual bool isIdle(void) { return true; };
     SpriteBatch* spriteBatch;
+    // Owned by the graphics manager, like the sprite batch.
+    SpriteBatch* staticBatch;
     bool created;
 private:
     std::vector<Widget*> widgets;
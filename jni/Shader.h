@@ -1,6 +1,7 @@
 #ifndef __SHADER_H__
 #define __SHADER_H__
 
+#include "GLState.h"
 #include "Resource.h"
 
 class Shader {
@@ -13,12 +14,13 @@ public:
     };
     ~Shader() {
         if (programId != 0) {
-            glDeleteProgram(programId);
+            GLState::getInstance()->deleteProgram(programId);
             LOG_DEBUG("Shader id:%d is dead.", programId);
             programId = 0;
         }
     };
-    status loadFromFile(const char* path) {
+    // Defines are inserted before the source, to build shader variants.
+    status loadFromFile(const char* path, const char* defines = NULL) {
         Resource resource(path);
         LOG_INFO("Loading Shader: %s", resource.getPath());
         GLuint vertexShader, fragmentShader;
@@ -40,13 +42,13 @@ public:
             return STATUS_ERROR;
         }
         resource.close();
-        const char *shaderStrings[2] = {NULL, shaderBuffer};
-        GLint stringsLengths[2] = {0, shaderLength};
+        const char *shaderStrings[3] = {NULL, (defines != NULL) ? defines : "", shaderBuffer};
+        GLint stringsLengths[3] = {0, (GLint)strlen(shaderStrings[1]), shaderLength};
         // Builds the vertex shader.
         shaderStrings[0] = "#define VERTEX\n";
         stringsLengths[0] = strlen(shaderStrings[0]);
         vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 2, shaderStrings, stringsLengths);
+        glShaderSource(vertexShader, 3, shaderStrings, stringsLengths);
         glCompileShader(vertexShader);
         glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &result);
         if (result == GL_FALSE) {
@@ -58,7 +60,7 @@ public:
         shaderStrings[0] = "#define FRAGMENT\n";
         stringsLengths[0] = strlen(shaderStrings[0]);
         fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 2, shaderStrings, stringsLengths);
+        glShaderSource(fragmentShader, 3, shaderStrings, stringsLengths);
         glCompileShader(fragmentShader);
         glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &result);
         if (result == GL_FALSE) {
@@ -91,7 +93,7 @@ ERROR:
         return STATUS_ERROR;
     };
     void apply() {
-        glUseProgram(programId);
+        GLState::getInstance()->useProgram(programId);
     };
     GLuint getProgramId() {
         return programId;
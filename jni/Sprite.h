@@ -1,113 +1,511 @@
 #ifndef __SPRITE_H__
 #define __SPRITE_H__
 
+#include <algorithm>
+
 #include "Tween.h"
 
-class SpriteBatch;
+class Sprite;
+
+// Generation checked reference to sprite data.
+struct SpriteHandle {
+    int index;
+    int generation;
+};
+
+// Texture and frame layout of a sprite, changes only on load.
+struct SpriteSheet {
+    GLuint textureId;
+    GLfloat texelWidth, texelHeight;
+    int spriteWidth, spriteHeight;
+    int sheetX, sheetY;
+    int sheetWidth, sheetHeight;
+    int frameXCount, frameYCount, frameCount;
+    const AtlasFrame* frames;
+    // Streamed frames, each one is a whole texture of the ring.
+    Flipbook* flipbook;
+    // Texture shown as a placeholder until its image is decoded.
+    Texture* loading;
+    // Texture has no transparent pixel in the sheet.
+    bool solid;
+};
+
+// Sprite data kept in parallel arrays indexed by slot, so the batch
+// streams through memory. Sprites address their slot via handles.
+class SpriteStore {
+public:
+    enum {
+        DIRTY_TRANSFORM = 1,
+        DIRTY_FRAME     = 2,
+        DIRTY_COLOR     = 4,
+        DIRTY_ALL       = 7,
+        // Drawn over or under other sprites, vertices are unchanged.
+        DIRTY_ORDER     = 8
+    };
+    SpriteStore():
+        locations(), scales(), angles(), pivots(),
+        colors(), opaques(), currentFrames(), orders(),
+        dirty(), transforms(), quads(), vertices(), textureIds(), solidFlags(),
+        serials(), sheets(), sprites(), orderChanged(false), nextSerial(0),
+        slotHandles(), handles(), freeHandles() {
+        //
+    };
+    int size() {
+        return sprites.size();
+    };
+    SpriteHandle add(Sprite* sprite, int width, int height) {
+        int slot = sprites.size();
+        locations.push_back(Vector2());
+        scales.push_back(Vector2(1.0f, 1.0f));
+        angles.push_back(0.0f);
+        pivots.push_back(Vector());
+        colors.push_back(Vector(1.0f, 1.0f, 1.0f));
+        opaques.push_back(1.0f);
+        currentFrames.push_back(0);
+        orders.push_back(0);
+        dirty.push_back(DIRTY_ALL);
+        transforms.push_back(Transform2D());
+        quads.push_back(Rect());
+        SpriteVertex vertex;
+        memset(&vertex, 0, sizeof(vertex));
+        vertices.insert(vertices.end(), 4, vertex);
+        textureIds.push_back(0);
+        solidFlags.push_back(false);
+        serials.push_back(nextSerial++);
+        orderChanged = true;
+        SpriteSheet sheet;
+        memset(&sheet, 0, sizeof(sheet));
+        sheet.spriteWidth = width;
+        sheet.spriteHeight = height;
+        sheets.push_back(sheet);
+        sprites.push_back(sprite);
+        // Reuses released handle entry, its generation tells stale handles apart.
+        SpriteHandle handle;
+        if (!freeHandles.empty()) {
+            handle.index = freeHandles.back();
+            freeHandles.pop_back();
+            handles[handle.index].slot = slot;
+            handle.generation = handles[handle.index].generation;
+        } else {
+            HandleEntry entry = { slot, 0 };
+            handle.index = handles.size();
+            handle.generation = 0;
+            handles.push_back(entry);
+        }
+        slotHandles.push_back(handle.index);
+        return handle;
+    };
+    // Moves the last sprite into the removed slot, takes constant time.
+    void remove(SpriteHandle handle) {
+        int slot = resolve(handle);
+        if (slot < 0) return;
+        HandleEntry& entry = handles[handle.index];
+        entry.slot = -1;
+        entry.generation++;
+        freeHandles.push_back(handle.index);
+        swapPop(locations, slot);
+        swapPop(scales, slot);
+        swapPop(angles, slot);
+        swapPop(pivots, slot);
+        swapPop(colors, slot);
+        swapPop(opaques, slot);
+        swapPop(currentFrames, slot);
+        swapPop(orders, slot);
+        swapPop(dirty, slot);
+        swapPop(transforms, slot);
+        swapPop(quads, slot);
+        swapPop(vertices, slot * 4, 4);
+        swapPop(textureIds, slot);
+        swapPop(solidFlags, slot);
+        swapPop(serials, slot);
+        swapPop(sheets, slot);
+        swapPop(sprites, slot);
+        swapPop(slotHandles, slot);
+        if (slot < (int)slotHandles.size()) handles[slotHandles[slot]].slot = slot;
+        orderChanged = true;
+    };
+    void clear() {
+        locations.clear(); scales.clear(); angles.clear(); pivots.clear();
+        colors.clear(); opaques.clear(); currentFrames.clear(); orders.clear();
+        dirty.clear(); transforms.clear(); quads.clear(); vertices.clear(); textureIds.clear(); solidFlags.clear();
+        serials.clear(); sheets.clear(); sprites.clear();
+        slotHandles.clear(); handles.clear(); freeHandles.clear();
+        orderChanged = true;
+        nextSerial = 0;
+    };
+    // Returns slot of the sprite, or -1 if handle is stale.
+    int resolve(SpriteHandle handle) {
+        if (handle.index < 0 || handle.index >= (int)handles.size()) return -1;
+        const HandleEntry& entry = handles[handle.index];
+        return (entry.generation == handle.generation) ? entry.slot : -1;
+    };
+    // Trimmed frames move the quad too, visibility depends on frame.
+    void markFrameDirty(int slot) {
+        dirty[slot] |= DIRTY_FRAME | DIRTY_COLOR;
+        if (sheets[slot].frames != NULL) dirty[slot] |= DIRTY_TRANSFORM;
+    };
+    // Rebuilds changed UVs and colors, returns true if corners have to
+    // be transformed with the slot transform and quad.
+    bool rebuild(int slot) {
+        const SpriteSheet& sheet = sheets[slot];
+        int flags = dirty[slot];
+        if (flags == 0) return false;
+        // Sprites whose image failed to load stay hidden, their changes
+        // are dropped so that they do not keep the batch changed.
+        if (sheet.sheetWidth == 0 || sheet.sheetHeight == 0) {
+            for (int i = 0; i < 4; ++i) vertices[slot * 4 + i].a = 0;
+            dirty[slot] = 0;
+            return false;
+        }
+        bool moved = (flags & DIRTY_TRANSFORM) != 0;
+        SpriteVertex* quadVertices = &vertices[slot * 4];
+        // Frames outside of the sheet are not visible, they must not
+        // sample neighbour images of the atlas page.
+        int currentFrame = currentFrames[slot];
+        bool visible = (currentFrame >= 0 && currentFrame < sheet.frameCount);
+        int frame = visible ? currentFrame : 0;
+        if (flags & (DIRTY_TRANSFORM | DIRTY_FRAME)) {
+            Vector framePivot;
+            getFrameQuad(slot, quads[slot], framePivot);
+            GLfloat u1, u2, v1, v2;
+            if (sheet.frames != NULL) {
+                // Trimmed frame covers only a part of the sprite.
+                const AtlasFrame& atlasFrame = sheet.frames[frame];
+                u1 = GLfloat(atlasFrame.x) * sheet.texelWidth;
+                u2 = GLfloat(atlasFrame.x + atlasFrame.width) * sheet.texelWidth;
+                v1 = GLfloat(atlasFrame.y) * sheet.texelHeight;
+                v2 = GLfloat(atlasFrame.y + atlasFrame.height) * sheet.texelHeight;
+            } else {
+                int currentFrameX, currentFrameY;
+                // Flipbook frames take the whole texture.
+                int sheetFrame = (sheet.flipbook != NULL) ? 0 : frame;
+                // Computes frame X and Y indexes from its id.
+                currentFrameX = sheetFrame % sheet.frameXCount;
+                // currentFrameY is converted from OpenGL coordinates to top-left coordinates.
+                currentFrameY = sheet.frameYCount - 1 - (sheetFrame / sheet.frameXCount);
+                // Draws selected frame.
+                u1 = GLfloat(sheet.sheetX + currentFrameX * sheet.spriteWidth) * sheet.texelWidth;
+                u2 = GLfloat(sheet.sheetX + (currentFrameX + 1) * sheet.spriteWidth) * sheet.texelWidth;
+                v1 = GLfloat(sheet.sheetY + currentFrameY * sheet.spriteHeight) * sheet.texelHeight;
+                v2 = GLfloat(sheet.sheetY + (currentFrameY + 1) * sheet.spriteHeight) * sheet.texelHeight;
+            }
+            if (flags & DIRTY_FRAME) {
+                quadVertices[0].u = u1; quadVertices[0].v = v1;
+                quadVertices[1].u = u1; quadVertices[1].v = v2;
+                quadVertices[2].u = u2; quadVertices[2].v = v1;
+                quadVertices[3].u = u2; quadVertices[3].v = v2;
+            }
+            if (moved) transforms[slot].Set(locations[slot], scales[slot], angles[slot], pivots[slot] + framePivot);
+        }
+        if (flags & DIRTY_COLOR) {
+            // Packs color and opaque, shared by all corners.
+            const Vector& color = colors[slot];
+            GLubyte r = packColor(color.x);
+            GLubyte g = packColor(color.y);
+            GLubyte b = packColor(color.z);
+            GLubyte a = visible ? packColor(opaques[slot]) : 0;
+            for (int i = 0; i < 4; ++i) {
+                quadVertices[i].r = r; quadVertices[i].g = g; quadVertices[i].b = b; quadVertices[i].a = a;
+            }
+        }
+        dirty[slot] = 0;
+        return moved;
+    };
+    // Quad of the current frame around the sprite center, and the pivot
+    // offset of trimmed frames, as the slot is drawn.
+    void getFrameQuad(int slot, Rect& quad, Vector& framePivot) {
+        const SpriteSheet& sheet = sheets[slot];
+        float halfWidth = (float)sheet.spriteWidth * 0.5f;
+        float halfHeight = (float)sheet.spriteHeight * 0.5f;
+        int currentFrame = currentFrames[slot];
+        int frame = (currentFrame >= 0 && currentFrame < sheet.frameCount) ? currentFrame : 0;
+        if (sheet.frames != NULL) {
+            const AtlasFrame& atlasFrame = sheet.frames[frame];
+            quad.left = (float)atlasFrame.offsetX - halfWidth;
+            quad.bottom = (float)atlasFrame.offsetY - halfHeight;
+            quad.right = quad.left + atlasFrame.width;
+            quad.top = quad.bottom + atlasFrame.height;
+            framePivot = Vector(atlasFrame.pivotX, atlasFrame.pivotY, 0.0f);
+        } else {
+            quad = Rect(-halfWidth, halfHeight, halfWidth, -halfHeight);
+            framePivot = Vector();
+        }
+    };
+    // Sprite opaque or frame makes all its pixels transparent.
+    bool isTransparent(int slot) {
+        return packColor(opaques[slot]) == 0 || (dirty[slot] == 0 && vertices[slot * 4].a == 0);
+    };
+    // Quad corners lie out of the viewport on one side.
+    bool isOutside(int slot, float width, float height) {
+        Rect bounds = getBounds(slot);
+        return bounds.right < 0.0f || bounds.left > width || bounds.top < 0.0f || bounds.bottom > height;
+    };
+    // Axis aligned bounds of the last built quad.
+    Rect getBounds(int slot) {
+        const SpriteVertex* quadVertices = &vertices[slot * 4];
+        Rect bounds(quadVertices[0].x, quadVertices[0].y, quadVertices[0].x, quadVertices[0].y);
+        for (int i = 1; i < 4; ++i) {
+            bounds.left = std::min(bounds.left, quadVertices[i].x);
+            bounds.right = std::max(bounds.right, quadVertices[i].x);
+            bounds.bottom = std::min(bounds.bottom, quadVertices[i].y);
+            bounds.top = std::max(bounds.top, quadVertices[i].y);
+        }
+        return bounds;
+    };
+    // Solid sprites cover their quad entirely and can be drawn without
+    // blending, in any order. Transparent placeholders of loading images
+    // are blended.
+    bool isSolid(int slot) {
+        if (sheets[slot].loading != NULL) return false;
+        return (sheets[slot].solid || solidFlags[slot]) && vertices[slot * 4].a == 0xFF;
+    };
+    void setCorners(int slot, const float corners[8]) {
+        SpriteVertex* quadVertices = &vertices[slot * 4];
+        for (int i = 0; i < 4; ++i) {
+            quadVertices[i].x = corners[i * 2];
+            quadVertices[i].y = corners[i * 2 + 1];
+        }
+    };
+    // Hot data.
+    std::vector<Vector2> locations;
+    std::vector<Vector2> scales;
+    std::vector<float> angles;
+    std::vector<Vector> pivots;
+    std::vector<Vector> colors;
+    std::vector<float> opaques;
+    std::vector<int> currentFrames;
+    std::vector<int> orders;
+    std::vector<int> dirty;
+    std::vector<Transform2D> transforms;
+    std::vector<Rect> quads;
+    std::vector<SpriteVertex> vertices;
+    std::vector<GLuint> textureIds;
+    std::vector<char> solidFlags;
+    // Cold data.
+    std::vector<unsigned int> serials;
+    std::vector<SpriteSheet> sheets;
+    std::vector<Sprite*> sprites;
+    // Set when draw order has to be sorted again.
+    bool orderChanged;
+private:
+    unsigned int nextSerial;
+    struct HandleEntry {
+        int slot;
+        int generation;
+    };
+    static GLubyte packColor(float value) {
+        return (GLubyte)(CLAMP(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+    // Replaces elements at index with the last ones.
+    template<class T>
+    static void swapPop(std::vector<T>& array, int index, int count = 1) {
+        int last = array.size() - count;
+        if (index != last) std::copy(array.begin() + last, array.end(), array.begin() + index);
+        array.resize(last);
+    };
+    std::vector<int> slotHandles;
+    std::vector<HandleEntry> handles;
+    std::vector<int> freeHandles;
+};
 
+// Sprite is a handle to its data in the store of the sprite batch.
 class Sprite: public Tweenable {
 public:
-    struct Vertex {
-        GLfloat x, y, u, v;
-    };
-    Sprite(const char* texturePath, int width, int height):
-        order(0),
-        location(),
-        angle(0.0f),
-        pivot(Vector()),
-        scale(Vector2(1.0f, 1.0f)),
-        color(Vector(1.0f, 1.0f, 1.0f)), opaque(1.0f),
-        texturePath(texturePath), textureId(0),
-        sheetWidth(0), sheetHeight(0),
-        spriteWidth(width), spriteHeight(height),
-        frameCount(0), frameXCount(0), frameYCount(0),
-        currentFrame(0) {
+    Sprite(SpriteStore* store, const char* texturePath, int width, int height):
+        store(store),
+        texturePath(texturePath),
+        spriteWidth(width), spriteHeight(height) {
         // LOG_DEBUG("Create sprite.");
+        handle = store->add(this, width, height);
     };
     ~Sprite() {
         // LOG_DEBUG("Delete sprite.");
     };
+    SpriteHandle getHandle() {
+        return handle;
+    };
     void setFrame(int frame) {
-        currentFrame = frame;
+        int slot = store->resolve(handle);
+        if (slot < 0 || frame == store->currentFrames[slot]) return;
+        store->currentFrames[slot] = frame;
+        store->markFrameDirty(slot);
     };
     int getFrame() {
-        return currentFrame;
+        int slot = store->resolve(handle);
+        return (slot < 0) ? 0 : store->currentFrames[slot];
+    };
+    // Transformations.
+    void setLocation(Vector2 value) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return;
+        store->locations[slot] = value;
+        store->dirty[slot] |= SpriteStore::DIRTY_TRANSFORM;
+    };
+    Vector2 getLocation() {
+        int slot = store->resolve(handle);
+        return (slot < 0) ? Vector2() : store->locations[slot];
+    };
+    void setScale(Vector2 value) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return;
+        store->scales[slot] = value;
+        store->dirty[slot] |= SpriteStore::DIRTY_TRANSFORM;
+    };
+    Vector2 getScale() {
+        int slot = store->resolve(handle);
+        return (slot < 0) ? Vector2() : store->scales[slot];
+    };
+    void setAngle(float value) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return;
+        store->angles[slot] = value;
+        store->dirty[slot] |= SpriteStore::DIRTY_TRANSFORM;
+    };
+    float getAngle() {
+        int slot = store->resolve(handle);
+        return (slot < 0) ? 0.0f : store->angles[slot];
+    };
+    void setPivot(Vector value) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return;
+        store->pivots[slot] = value;
+        store->dirty[slot] |= SpriteStore::DIRTY_TRANSFORM;
+    };
+    Vector getPivot() {
+        int slot = store->resolve(handle);
+        return (slot < 0) ? Vector() : store->pivots[slot];
+    };
+    void setColor(Vector value) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return;
+        store->colors[slot] = value;
+        store->dirty[slot] |= SpriteStore::DIRTY_COLOR;
+    };
+    Vector getColor() {
+        int slot = store->resolve(handle);
+        return (slot < 0) ? Vector() : store->colors[slot];
+    };
+    void setOpaque(float value) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return;
+        store->opaques[slot] = value;
+        store->dirty[slot] |= SpriteStore::DIRTY_COLOR;
+    };
+    float getOpaque() {
+        int slot = store->resolve(handle);
+        return (slot < 0) ? 0.0f : store->opaques[slot];
+    };
+    // Flags sprite as fully opaque, when its texture was not detected so.
+    void setSolid(bool value) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return;
+        store->solidFlags[slot] = value;
+    };
+    bool isSolid() {
+        int slot = store->resolve(handle);
+        return (slot < 0) ? false : store->isSolid(slot);
+    };
+    void setOrder(int value) {
+        int slot = store->resolve(handle);
+        if (slot < 0 || store->orders[slot] == value) return;
+        store->orders[slot] = value;
+        store->orderChanged = true;
+        // Sprite is drawn again over or under others.
+        store->dirty[slot] |= SpriteStore::DIRTY_ORDER;
+    };
+    int getOrder() {
+        int slot = store->resolve(handle);
+        return (slot < 0) ? 0 : store->orders[slot];
     };
     int getValues(int tweenType, float* returnValues) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return 0;
         switch (tweenType) {
             case TweenType::POSITION_X:
-                returnValues[0] = location.x;
+                returnValues[0] = store->locations[slot].x;
                 return 1;
             case TweenType::POSITION_Y:
-                returnValues[0] = location.y;
+                returnValues[0] = store->locations[slot].y;
                 return 1;
             case TweenType::POSITION_XY:
-                returnValues[0] = location.x;
-                returnValues[1] = location.y;
+                returnValues[0] = store->locations[slot].x;
+                returnValues[1] = store->locations[slot].y;
                 return 2;
             case TweenType::ROTATION_CW:
             case TweenType::ROTATION_CCW:
-                angle = returnValues[0] = angle;
+                returnValues[0] = store->angles[slot];
                 return 1;
             case TweenType::SCALE_X:
-                returnValues[0] = scale.x;
+                returnValues[0] = store->scales[slot].x;
                 return 1;
             case TweenType::SCALE_Y:
-                returnValues[0] = scale.y;
+                returnValues[0] = store->scales[slot].y;
                 return 1;
             case TweenType::SCALE_XY:
-                returnValues[0] = scale.x;
-                returnValues[1] = scale.y;
+                returnValues[0] = store->scales[slot].x;
+                returnValues[1] = store->scales[slot].y;
                 return 2;
             case TweenType::OPAQUE:
-                returnValues[0] = opaque;
+                returnValues[0] = store->opaques[slot];
                 return 1;
             case TweenType::COLOR:
-                returnValues[0] = color.x; // r
-                returnValues[1] = color.y; // g
-                returnValues[2] = color.z; // b
+                returnValues[0] = store->colors[slot].x; // r
+                returnValues[1] = store->colors[slot].y; // g
+                returnValues[2] = store->colors[slot].z; // b
                 return 3;
             case TweenType::FRAME:
-                returnValues[0] = currentFrame;
+                returnValues[0] = store->currentFrames[slot];
                 return 1;
         }
         return 0;
     };
     void setValues(int tweenType, float* newValues) {
+        int slot = store->resolve(handle);
+        if (slot < 0) return;
+        int frame;
         switch (tweenType) {
             case TweenType::POSITION_X:
-                location.x = newValues[0];
+                store->locations[slot].x = newValues[0];
                 break;
             case TweenType::POSITION_Y:
-                location.y = newValues[0];
+                store->locations[slot].y = newValues[0];
                 break;
             case TweenType::POSITION_XY:
-                location.x = newValues[0];
-                location.y = newValues[1];
+                store->locations[slot] = Vector2(newValues[0], newValues[1]);
                 break;
             case TweenType::ROTATION_CW:
             case TweenType::ROTATION_CCW:
-                angle = newValues[0];
+                store->angles[slot] = newValues[0];
                 break;
             case TweenType::SCALE_X:
-                scale.x = newValues[0];
+                store->scales[slot].x = newValues[0];
                 break;
             case TweenType::SCALE_Y:
-                scale.y = newValues[0];
+                store->scales[slot].y = newValues[0];
                 break;
             case TweenType::SCALE_XY:
-                scale = Vector2(newValues[0], newValues[1]);
+                store->scales[slot] = Vector2(newValues[0], newValues[1]);
                 break;
             case TweenType::OPAQUE:
-                opaque = newValues[0];
-                break;
+                store->opaques[slot] = newValues[0];
+                store->dirty[slot] |= SpriteStore::DIRTY_COLOR;
+                return;
             case TweenType::COLOR:
-                color = Vector(newValues[0], newValues[1], newValues[2]);
-                break;
+                store->colors[slot] = Vector(newValues[0], newValues[1], newValues[2]);
+                store->dirty[slot] |= SpriteStore::DIRTY_COLOR;
+                return;
             case TweenType::FRAME:
-                currentFrame = (int)round(newValues[0]);
-                break;
+                frame = (int)round(newValues[0]);
+                if (frame != store->currentFrames[slot]) {
+                    store->currentFrames[slot] = frame;
+                    store->markFrameDirty(slot);
+                }
+                return;
+            default:
+                return;
         }
+        // Rest of tweens change location, rotation or scale.
+        store->dirty[slot] |= SpriteStore::DIRTY_TRANSFORM;
     };
     int getWidth() {
         return spriteWidth;
@@ -116,8 +514,19 @@ public:
         return spriteHeight;
     };
     bool pointInSprite(int x, int y) {
-        Vector points[4];  // sprite polygon with 4 points
-        transform(points); // tansform it ...
+        int slot = store->resolve(handle);
+        if (slot < 0) return false;
+        Vector2 points[4];  // sprite polygon with 4 points
+        // Same quad and transform as drawn, trimmed frames included.
+        Rect quad;
+        Vector framePivot;
+        store->getFrameQuad(slot, quad, framePivot);
+        Transform2D spriteTransform;
+        spriteTransform.Set(store->locations[slot], store->scales[slot], store->angles[slot], store->pivots[slot] + framePivot); // tansform it ...
+        points[0] = spriteTransform.Apply(quad.left, quad.bottom);
+        points[1] = spriteTransform.Apply(quad.left, quad.top);
+        points[2] = spriteTransform.Apply(quad.right, quad.bottom);
+        points[3] = spriteTransform.Apply(quad.right, quad.top);
         // This method counts the number of times a ray starting from a point (x, y) crosses
         // a polygon boundary edge separating it's inside and outside.
         std::swap(points[2], points[3]);
@@ -135,67 +544,62 @@ public:
 protected:
     friend class SpriteBatch;
     status load() {
-        Texture* texture = GraphicsManager::getInstance()->loadTexture(texturePath, GL_LINEAR, GL_CLAMP_TO_EDGE);
-        textureId = texture->getTextureId();
-        sheetWidth = texture->getWidth();
-        sheetHeight = texture->getHeight();
-        frameXCount = sheetWidth / spriteWidth;
-        frameYCount = sheetHeight / spriteHeight;
-        frameCount = (sheetHeight / spriteHeight) * (sheetWidth / spriteWidth);
+        int slot = store->resolve(handle);
+        if (slot < 0) return STATUS_ERROR;
+        // Sprite sheet may be streamed frame by frame.
+        Flipbook* flipbook = GraphicsManager::getInstance()->loadFlipbook(texturePath);
+        if (flipbook != NULL) return loadFlipbook(slot, flipbook);
+        // Sprite sheet may be a region of the texture atlas page.
+        TextureRegion region;
+        if (GraphicsManager::getInstance()->loadTextureRegion(texturePath, GL_LINEAR, GL_CLAMP_TO_EDGE, region) != STATUS_OK) return STATUS_ERROR;
+        SpriteSheet& sheet = store->sheets[slot];
+        sheet.textureId = region.texture->getTextureId();
+        sheet.texelWidth = 1.0f / GLfloat(region.texture->getWidth());
+        sheet.texelHeight = 1.0f / GLfloat(region.texture->getHeight());
+        sheet.sheetX = region.x;
+        sheet.sheetY = region.y;
+        sheet.sheetWidth = region.width;
+        sheet.sheetHeight = region.height;
+        sheet.frameXCount = sheet.sheetWidth / spriteWidth;
+        sheet.frameYCount = sheet.sheetHeight / spriteHeight;
+        sheet.frameCount = sheet.frameXCount * sheet.frameYCount;
+        // Prebuilt sheet frames are listed, not derived from the grid.
+        sheet.frames = region.frames;
+        if (sheet.frames != NULL) sheet.frameCount = region.frameCount;
+        sheet.solid = region.solid;
+        sheet.flipbook = NULL;
+        sheet.loading = region.texture->isReady() ? NULL : region.texture;
+        store->textureIds[slot] = sheet.textureId;
+        store->dirty[slot] = SpriteStore::DIRTY_ALL;
         return STATUS_OK;
     };
-    void draw(Vertex vertices[4]) {
-        if (sheetWidth == 0 || sheetHeight == 0) return;
-        int currentFrameX, currentFrameY;
-        // Computes frame X and Y indexes from its id.
-        currentFrameX = currentFrame % frameXCount;
-        // currentFrameY is converted from OpenGL coordinates to top-left coordinates.
-        currentFrameY = frameYCount - 1 - (currentFrame / frameXCount);
-        // Draws selected frame.
-        GLfloat u1 = GLfloat(currentFrameX * spriteWidth) / GLfloat(sheetWidth);
-        GLfloat u2 = GLfloat((currentFrameX + 1) * spriteWidth) / GLfloat(sheetWidth);
-        GLfloat v1 = GLfloat(currentFrameY * spriteHeight) / GLfloat(sheetHeight);
-        GLfloat v2 = GLfloat((currentFrameY + 1) * spriteHeight) / GLfloat(sheetHeight);
-        Vector points[4];
-        transform(points);
-        // Fill sprite vertices.
-        vertices[0].x = points[0].x; vertices[0].y = points[0].y; vertices[0].u = u1; vertices[0].v = v1;
-        vertices[1].x = points[1].x; vertices[1].y = points[1].y; vertices[1].u = u1; vertices[1].v = v2;
-        vertices[2].x = points[2].x; vertices[2].y = points[2].y; vertices[2].u = u2; vertices[2].v = v1;
-        vertices[3].x = points[3].x; vertices[3].y = points[3].y; vertices[3].u = u2; vertices[3].v = v2;
+    // Frame texture changes as frames are decoded, the sprite batch keeps
+    // it up to date.
+    status loadFlipbook(int slot, Flipbook* flipbook) {
+        SpriteSheet& sheet = store->sheets[slot];
+        sheet.textureId = flipbook->update(store->currentFrames[slot]);
+        sheet.texelWidth = 1.0f / GLfloat(flipbook->getFrameWidth());
+        sheet.texelHeight = 1.0f / GLfloat(flipbook->getFrameHeight());
+        sheet.sheetX = 0;
+        sheet.sheetY = 0;
+        sheet.sheetWidth = flipbook->getFrameWidth();
+        sheet.sheetHeight = flipbook->getFrameHeight();
+        sheet.frameXCount = 1;
+        sheet.frameYCount = 1;
+        sheet.frameCount = flipbook->getFrameCount();
+        sheet.frames = NULL;
+        sheet.flipbook = flipbook;
+        sheet.loading = NULL;
+        sheet.solid = flipbook->isSolid();
+        store->textureIds[slot] = sheet.textureId;
+        store->dirty[slot] = SpriteStore::DIRTY_ALL;
+        return STATUS_OK;
     };
-public:
-    // Tratsormations.
-    int order;    
-    Vector2 location;
-    Vector2 scale;
-    float angle;
-    Vector pivot;    
-    Vector color;
-    float opaque;
 private:
-    void transform(Vector points[4]) {
-        // Apply transformations.
-        Matrix matrix = IdentityMatrix;
-        matrix.Translate(location.x, location.y, 0.0f);
-        matrix.Translate(pivot.x, pivot.y, 0.0f);
-        matrix.Rotate(angle, AxisZ);
-        matrix.Translate(-pivot.x, -pivot.y, 0.0f);
-        matrix.Scale(scale.x, scale.y, 1.0f);
-        float halfWidth = (float)spriteWidth * 0.5f;
-        float halfHeight = (float)spriteHeight * 0.5f;
-        points[0] = matrix * Vector(-halfWidth, -halfHeight, 0.0f);
-        points[1] = matrix * Vector(-halfWidth,  halfHeight, 0.0f);
-        points[2] = matrix * Vector( halfWidth, -halfHeight, 0.0f);
-        points[3] = matrix * Vector( halfWidth,  halfHeight, 0.0f);
-    };
+    SpriteStore* store;
+    SpriteHandle handle;
     const char* texturePath;
-    GLuint textureId;
-    // Frame.
     int spriteWidth, spriteHeight;
-    int sheetWidth, sheetHeight;
-    int frameXCount, frameYCount, frameCount;
-    int currentFrame;
 };
 
-#endif // __SPRITE_H__
\ No newline at end of file
+#endif // __SPRITE_H__
@@ -1,6 +1,8 @@
 #ifndef __SPRITEBATCH_H__
 #define __SPRITEBATCH_H__
 
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 #include "GraphicsManager.h"
@@ -10,9 +12,9 @@
 class SpriteBatch: public GraphicsComponent {
 public:
     SpriteBatch():
-        sprites(), vertices(), indexes(),
-        shaderProgram(0),
-        aPosition(0), aTexture(0), uProjection(0), uTexture(0), uColor(0), uOpaque(0) {
+        store(), drawOrder(), visibleSlots(), lastVisibleSlots(), drawSlots(), sortSlots(), sortKeys(), sortTempKeys(),
+        changedSlots(), movedSlots(), transforms(), quads(), corners(),
+        layer(0), program() {
         LOG_DEBUG("Create SpriteBatch.");
         GraphicsManager::getInstance()->registerComponent(this);
     };
@@ -21,71 +23,48 @@ public:
         reset();
     };
     Sprite* registerSprite(const char* texturePath, int width, int height) {
-        int spriteCount = sprites.size();
-        // Points to 1st vertex.
-        int index = spriteCount * vertexPerSprite;
-        // Precomputes the index buffer.
-        indexes.push_back(index+0);
-        indexes.push_back(index+1);
-        indexes.push_back(index+2);
-        indexes.push_back(index+2);
-        indexes.push_back(index+1);
-        indexes.push_back(index+3);
-        for (int i = 0; i < vertexPerSprite; ++i) {
-            vertices.push_back(Sprite::Vertex());
-        }
-        // Appends a new sprite to the sprite array.
-        Sprite* sprite = new Sprite(texturePath, width, height);
-        sprites.push_back(sprite);
+        // Appends a new sprite to the sprite store.
+        Sprite* sprite = new Sprite(&store, texturePath, width, height);
         sprite->load();
         return sprite;
     };
     void unregisterSprite(Sprite* sprite) {
-        std::vector<Sprite*>::iterator it = find(sprites.begin(), sprites.end(), sprite);
-        if (it != sprites.end()) {
-            int n = std::distance(sprites.begin(), it);
-            SAFE_DELETE(*it);
-            sprites.erase(std::remove(sprites.begin(), sprites.end(), *it), sprites.end());
-            vertices.erase(vertices.begin() + n * vertexPerSprite, vertices.begin() + (n+1) * vertexPerSprite);
-            // Recreate indexes.
-            indexes.clear();
-            for (std::vector<Sprite*>::iterator it = sprites.begin(); it < sprites.end(); ++it) {
-                int n = std::distance(sprites.begin(), it);
-                // Points to 1st vertex.
-                int index = n * vertexPerSprite;
-                // Precomputes the index buffer.
-                indexes.push_back(index+0);
-                indexes.push_back(index+1);
-                indexes.push_back(index+2);
-                indexes.push_back(index+2);
-                indexes.push_back(index+1);
-                indexes.push_back(index+3);
-            }
-        }
+        int slot = store.resolve(sprite->getHandle());
+        if (slot < 0 || store.sprites[slot] != sprite) return;
+        if (isShown(slot)) GraphicsManager::getInstance()->addDamage(store.getBounds(slot));
+        store.remove(sprite->getHandle());
+        SAFE_DELETE(sprite);
     };
     void reset() {
-        LOG_DEBUG("Delete %d sprites.", sprites.size());
-        int n = 0;
-        for (std::vector<Sprite*>::iterator it = sprites.begin(); it < sprites.end(); ++it) {
-            // LOG_DEBUG("%d", ++n);
+        LOG_DEBUG("Delete %d sprites.", store.size());
+        for (std::vector<Sprite*>::iterator it = store.sprites.begin(); it < store.sprites.end(); ++it) {
             SAFE_DELETE(*it);
         }
-        indexes.clear();
-        vertices.clear();
-        sprites.clear();
+        store.clear();
     }
     status load() {
-        // Creates and retrieves shader attributes and uniforms.
-        Shader* shader = GraphicsManager::getInstance()->loadShader("shaders/Sprite.shader");
-        shaderProgram = shader->getProgramId();
-        aPosition = glGetAttribLocation(shaderProgram, "aPosition");
-        aTexture = glGetAttribLocation(shaderProgram, "aTexture");
-        uProjection = glGetUniformLocation(shaderProgram, "uProjection");
-        uTexture = glGetUniformLocation(shaderProgram, "uTexture");
-        uColor = glGetUniformLocation(shaderProgram, "uColor");
-        uOpaque = glGetUniformLocation(shaderProgram, "uOpaque");
+        // Creates and retrieves shader attributes and uniforms. When the
+        // device has several texture units, the variant sampling one of
+        // them per vertex lets a draw span textures.
+        int textureSlots = GraphicsManager::getInstance()->getTextureSlots();
+        Shader* shader = (textureSlots > 1)
+            ? GraphicsManager::getInstance()->loadShader("shaders/Sprite.shader", textureSlotDefines(textureSlots).c_str())
+            : GraphicsManager::getInstance()->loadShader("shaders/Sprite.shader");
+        if (shader == NULL) goto ERROR;
+        program.programId = shader->getProgramId();
+        program.aPosition = glGetAttribLocation(program.programId, "aPosition");
+        program.aTexture = glGetAttribLocation(program.programId, "aTexture");
+        program.aColor = glGetAttribLocation(program.programId, "aColor");
+        program.uProjection = glGetUniformLocation(program.programId, "uProjection");
+        program.uTexture = glGetUniformLocation(program.programId, "uTexture");
+        program.aSlot = (textureSlots > 1) ? glGetAttribLocation(program.programId, "aSlot") : -1;
+        program.textureSlots = textureSlots;
+        // Attribute arrays are enabled by location bits.
+        if (!GLState::isAttribLocationValid(program.aPosition) || !GLState::isAttribLocationValid(program.aTexture)
+                || !GLState::isAttribLocationValid(program.aColor)
+                || (program.aSlot != -1 && !GLState::isAttribLocationValid(program.aSlot))) goto ERROR;
         // Loads sprites.
-        for (std::vector<Sprite*>::iterator it = sprites.begin(); it < sprites.end(); ++it) {
+        for (std::vector<Sprite*>::iterator it = store.sprites.begin(); it < store.sprites.end(); ++it) {
             if ((*it)->load() != STATUS_OK) goto ERROR;
         }
         return STATUS_OK;
@@ -93,71 +72,238 @@ ERROR:
         LOG_ERROR("Error loading sprite batch.");
         return STATUS_ERROR;
     };
+    // Applies sprite changes, the bounds they had and have now are damaged.
+    void prepare() {
+        int spriteCount = store.size();
+        GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+        if (spriteCount == 0) {
+            // Nothing left to draw, removals are handled.
+            store.orderChanged = false;
+            visibleSlots.clear();
+            lastVisibleSlots.clear();
+            return;
+        }
+        // Streamed frames are shown as they are decoded.
+        for (int slot = 0; slot < spriteCount; ++slot) {
+            Flipbook* flipbook = store.sheets[slot].flipbook;
+            if (flipbook == NULL) continue;
+            GLuint textureId = flipbook->update(store.currentFrames[slot]);
+            if (textureId == store.textureIds[slot]) continue;
+            store.textureIds[slot] = store.sheets[slot].textureId = textureId;
+            store.dirty[slot] |= SpriteStore::DIRTY_COLOR;
+        }
+        // Uploaded images may be solid, prebuilt sheets keep the flags of
+        // their frames.
+        if (graphicsManager->hasUploadedTextures()) {
+            for (int slot = 0; slot < spriteCount; ++slot) {
+                SpriteSheet& sheet = store.sheets[slot];
+                if (sheet.loading == NULL || !sheet.loading->isReady()) continue;
+                if (sheet.frames == NULL) sheet.solid = sheet.loading->isSolid();
+                sheet.loading = NULL;
+            }
+        }
+        // Any rebuilt sprite, new order or culling change redraws the
+        // layer, when it is cached.
+        bool changed = store.orderChanged;
+        // Slots are drawn through the order list, sorted only on change.
+        if (store.orderChanged) {
+            sortDrawOrder(spriteCount);
+            store.orderChanged = false;
+        }
+        // Rebuilds changed sprites, moved ones are transformed at once.
+        changedSlots.clear();
+        movedSlots.clear();
+        transforms.clear();
+        quads.clear();
+        for (int slot = 0; slot < spriteCount; ++slot) {
+            // Invisible sprites stay dirty until they are shown again.
+            if (store.dirty[slot] == 0) continue;
+            bool shown = isShown(slot);
+            if (shown) graphicsManager->addDamage(store.getBounds(slot));
+            if (store.isTransparent(slot)) {
+                // Hidden sprites keep their changes, their vertices are
+                // cleared so that they are not seen as changed again.
+                if (shown) {
+                    hide(slot);
+                    changed = true;
+                }
+                continue;
+            }
+            changed = true;
+            changedSlots.push_back(slot);
+            if (!store.rebuild(slot)) continue;
+            movedSlots.push_back(slot);
+            transforms.push_back(store.transforms[slot]);
+            quads.push_back(store.quads[slot]);
+        }
+        int movedCount = movedSlots.size();
+        if (movedCount > 0) {
+            corners.resize(movedCount * 8);
+            TransformQuads(&transforms[0], &quads[0], &corners[0], movedCount);
+            for (int i = 0; i < movedCount; ++i) {
+                store.setCorners(movedSlots[i], &corners[i * 8]);
+            }
+        }
+        for (std::vector<int>::iterator it = changedSlots.begin(); it < changedSlots.end(); ++it) {
+            graphicsManager->addDamage(store.getBounds(*it));
+        }
+        // Culls transparent sprites and sprites outside of the viewport.
+        float renderWidth = (float)graphicsManager->getRenderWidth();
+        float renderHeight = (float)graphicsManager->getRenderHeight();
+        visibleSlots.clear();
+        for (int i = 0; i < spriteCount; ++i) {
+            int slot = drawOrder[i];
+            if (store.isTransparent(slot) || store.isOutside(slot, renderWidth, renderHeight)) continue;
+            visibleSlots.push_back(slot);
+        }
+        graphicsManager->countCulled(spriteCount - visibleSlots.size());
+        if (changed || visibleSlots != lastVisibleSlots) {
+            graphicsManager->invalidateLayer(layer);
+            lastVisibleSlots = visibleSlots;
+        }
+    };
     void draw() {
-        // Sort by order.
-        std::sort(sprites.begin(), sprites.end(), sort());
-        // Selects sprite shader and passes its parameters.
-        glUseProgram(shaderProgram);
-        glUniformMatrix4fv(uProjection, 1, GL_FALSE, GraphicsManager::getInstance()->getProjectionMatrix());
-        glUniform1i(uTexture, 0);
-        // Indicates to OpenGL how position and uv coordinates are stored.
-        glEnableVertexAttribArray(aPosition);
-        glVertexAttribPointer(aPosition, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite::Vertex), &(vertices[0].x));
-        glEnableVertexAttribArray(aTexture);
-        glVertexAttribPointer(aTexture, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite::Vertex), &(vertices[0].u));
-        // Activates transparency.
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        // Renders all sprites in batch.
-        int spriteCount = sprites.size();
+        GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+        RenderQueue* renderQueue = graphicsManager->getRenderQueue();
+        // Only sprites in the damaged part of the frame are drawn. Cached
+        // layers need all of them when redrawn, else they are one quad and
+        // a command without quads tells the queue to composite the layer.
+        std::vector<int>* slots = &visibleSlots;
+        if (renderQueue->isLayerCached(layer)) {
+            if (!renderQueue->isLayerDirty(layer)) {
+                if (!visibleSlots.empty()) renderQueue->submitQuads(layer, &program, 0, BLEND_NONE, 0);
+                return;
+            }
+        } else {
+            drawSlots.clear();
+            for (std::vector<int>::iterator it = visibleSlots.begin(); it < visibleSlots.end(); ++it) {
+                if (graphicsManager->isDamaged(store.getBounds(*it))) drawSlots.push_back(*it);
+            }
+            slots = &drawSlots;
+        }
+        // Submits sprites in draw order, one command per texture change.
+        // Color and opaque are per vertex and do not break the batch,
+        // solid sprites are sent apart to be drawn without blending.
+        int drawCount = slots->size();
         int currentSprite = 0, firstSprite = 0;
-        while (bool canDraw = (currentSprite < spriteCount)) {
-            // Switches texture.
-            Sprite* sprite = sprites[currentSprite];
-            GLuint currentTextureId = sprite->textureId;
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, sprite->textureId);
-            // Sprite color and opaque.
-            Vector currentColor = sprite->color;
-            float currentOpaque = sprite->opaque;
-            glUniform3fv(uColor, 1, sprite->color.data());
-            glUniform1fv(uOpaque, 1, &sprite->opaque);
-            // Generate sprite vertices for current textures.
-            do {
-                sprite = sprites[currentSprite];
-                if (
-                    sprite->color == currentColor &&
-                    sprite->opaque == currentOpaque &&
-                    sprite->textureId == currentTextureId
-                ) {
-                    Sprite::Vertex* spriteVertices = (&vertices[currentSprite * 4]);
-                    sprite->draw(spriteVertices);
-                } else break;
-            } while (canDraw == (++currentSprite < spriteCount));
-            // Renders sprites each time texture or other values changes.
-            glDrawElements(GL_TRIANGLES, (currentSprite - firstSprite) * indexPerSprite, GL_UNSIGNED_SHORT, &indexes[firstSprite * indexPerSprite]);
+        while (currentSprite < drawCount) {
+            int slot = (*slots)[currentSprite];
+            GLuint currentTextureId = store.textureIds[slot];
+            bool solid = store.isSolid(slot);
+            while (++currentSprite < drawCount) {
+                slot = (*slots)[currentSprite];
+                if (store.textureIds[slot] != currentTextureId || store.isSolid(slot) != solid) break;
+            }
+            int blend = solid ? BLEND_NONE : BLEND_ALPHA;
+            SpriteVertex* vertices = renderQueue->submitQuads(layer, &program, currentTextureId, blend, currentSprite - firstSprite);
+            for (int i = firstSprite; i < currentSprite; ++i, vertices += vertexPerSprite) {
+                memcpy(vertices, &store.vertices[(*slots)[i] * vertexPerSprite], vertexPerSprite * sizeof(SpriteVertex));
+            }
             firstSprite = currentSprite;
         }
-        // Cleans up OpenGL state.
-        glUseProgram(0);
-        glDisableVertexAttribArray(aPosition);
-        glDisableVertexAttribArray(aTexture);
-        glDisable(GL_BLEND);
+    };
+    bool tracksDamage() {
+        return true;
+    };
+    bool hasChanges() {
+        if (store.orderChanged) return true;
+        int spriteCount = store.size();
+        for (int slot = 0; slot < spriteCount; ++slot) {
+            if (store.dirty[slot] != 0 && (!store.isTransparent(slot) || isShown(slot))) return true;
+            // Visible frame is shown once decoded.
+            Flipbook* flipbook = store.sheets[slot].flipbook;
+            if (flipbook != NULL && !store.isTransparent(slot) && flipbook->isPending(store.currentFrames[slot])) return true;
+        }
+        return false;
+    };
+    // Batches of lower layers are drawn first, equal layers are drawn in
+    // registration order. Batches of a cached layer should hold sprites
+    // which rarely change.
+    void setLayer(int value) {
+        GraphicsManager::getInstance()->invalidateLayer(layer);
+        layer = value;
+        lastVisibleSlots.clear();
+    };
+    int getLayer() {
+        return layer;
     };
 private:
-    // Sort order.
-    struct sort { 
-        bool operator() (Sprite* a, Sprite* b) const { 
-            return a->order < b->order;
+    bool isShown(int slot) {
+        return store.vertices[slot * vertexPerSprite].a != 0;
+    };
+    void hide(int slot) {
+        SpriteVertex* vertices = &store.vertices[slot * vertexPerSprite];
+        for (int i = 0; i < vertexPerSprite; ++i) vertices[i].a = 0;
+    };
+    // Generates the selection of the sampler from the vertex slot, as
+    // samplers can only be indexed by constants.
+    static std::string textureSlotDefines(int textureSlots) {
+        char line[96];
+        snprintf(line, sizeof(line), "#define TEXTURE_SLOTS %d\n#define SAMPLE_SLOT(uv) ", textureSlots);
+        std::string defines = line;
+        for (int slot = 0; slot < textureSlots - 1; ++slot) {
+            snprintf(line, sizeof(line), "(vSlot < %d.5 ? texture2D(uTexture[%d], uv) : ", slot, slot);
+            defines.append(line);
+        }
+        snprintf(line, sizeof(line), "texture2D(uTexture[%d], uv)", textureSlots - 1);
+        defines.append(line);
+        defines.append(textureSlots - 1, ')');
+        defines.append("\n");
+        return defines;
+    };
+    // Radix sort of slots by order, then by creation, so equal orders
+    // keep a deterministic order. Digits shared by all sprites are skipped.
+    void sortDrawOrder(int spriteCount) {
+        drawOrder.resize(spriteCount);
+        sortSlots.resize(spriteCount);
+        sortKeys.resize(spriteCount);
+        sortTempKeys.resize(spriteCount);
+        int counts[8][256];
+        memset(counts, 0, sizeof(counts));
+        for (int i = 0; i < spriteCount; ++i) {
+            // Flips sign bit so negative orders come first.
+            uint64_t key = (uint64_t)((uint32_t)store.orders[i] ^ 0x80000000u) << 32 | store.serials[i];
+            sortKeys[i] = key;
+            drawOrder[i] = i;
+            for (int digit = 0; digit < 8; ++digit) {
+                counts[digit][(key >> (digit * 8)) & 0xFF]++;
+            }
+        }
+        for (int digit = 0; digit < 8; ++digit) {
+            int* count = counts[digit];
+            if (count[(sortKeys[0] >> (digit * 8)) & 0xFF] == spriteCount) continue;
+            int offset = 0;
+            for (int n = 0; n < 256; ++n) {
+                int size = count[n];
+                count[n] = offset;
+                offset += size;
+            }
+            for (int i = 0; i < spriteCount; ++i) {
+                int position = count[(sortKeys[i] >> (digit * 8)) & 0xFF]++;
+                sortTempKeys[position] = sortKeys[i];
+                sortSlots[position] = drawOrder[i];
+            }
+            sortKeys.swap(sortTempKeys);
+            drawOrder.swap(sortSlots);
         }
     };
-    const int indexPerSprite = 6;
     const int vertexPerSprite = 4;
-    std::vector<Sprite*> sprites;
-    std::vector<Sprite::Vertex> vertices;
-    std::vector<GLushort> indexes;
-    GLuint shaderProgram;
-    GLuint aPosition, aTexture, uProjection, uTexture, uColor, uOpaque;
+    SpriteStore store;
+    std::vector<int> drawOrder;
+    std::vector<int> visibleSlots;
+    std::vector<int> lastVisibleSlots;
+    std::vector<int> drawSlots;
+    std::vector<int> sortSlots;
+    std::vector<uint64_t> sortKeys;
+    std::vector<uint64_t> sortTempKeys;
+    // Batch transform of moved sprites.
+    std::vector<int> changedSlots;
+    std::vector<int> movedSlots;
+    std::vector<Transform2D> transforms;
+    std::vector<Rect> quads;
+    std::vector<float> corners;
+    int layer;
+    RenderProgram program;
 };
 
 #endif // __SPRITEBATCH_H__
\ No newline at end of file
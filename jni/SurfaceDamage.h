@@ -0,0 +1,122 @@
+#ifndef __SURFACEDAMAGE_H__
+#define __SURFACEDAMAGE_H__
+
+/* Tells EGL which parts of the window surface changed in a frame */
+
+#include <EGL/egl.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+// Declared here, older NDK headers lack these extensions.
+#ifndef EGL_BUFFER_AGE_KHR
+#define EGL_BUFFER_AGE_KHR 0x313D
+#endif
+typedef EGLBoolean (EGLAPIENTRYP SwapBuffersWithDamageProc)(EGLDisplay, EGLSurface, const EGLint*, EGLint);
+typedef EGLBoolean (EGLAPIENTRYP SetDamageRegionProc)(EGLDisplay, EGLSurface, EGLint*, EGLint);
+
+// Frames of damage kept for buffers older than the last one.
+const int SURFACE_DAMAGE_HISTORY = 4;
+
+// EGL functions used, host tests replace them by fakes.
+struct SurfaceDamageEGL {
+    const char* (EGLAPIENTRYP queryString)(EGLDisplay, EGLint);
+    __eglMustCastToProperFunctionPointerType (EGLAPIENTRYP getProcAddress)(const char*);
+    EGLBoolean (EGLAPIENTRYP querySurface)(EGLDisplay, EGLSurface, EGLint, EGLint*);
+    EGLBoolean (EGLAPIENTRYP swapBuffers)(EGLDisplay, EGLSurface);
+    EGLint (EGLAPIENTRYP getError)(void);
+};
+const SurfaceDamageEGL SURFACE_DAMAGE_EGL = {
+    eglQueryString, eglGetProcAddress, eglQuerySurface, eglSwapBuffers, eglGetError
+};
+
+class SurfaceDamage {
+public:
+    SurfaceDamage(const SurfaceDamageEGL& egl = SURFACE_DAMAGE_EGL):
+        egl(egl), swapBuffersWithDamage(NULL), setDamageRegion(NULL),
+        history(), historySize(0) {
+        //
+    };
+    // Looks for damage extensions of the display, without them swaps
+    // take the whole surface.
+    void initialize(EGLDisplay display) {
+        const char* extensions = egl.queryString(display, EGL_EXTENSIONS);
+        swapBuffersWithDamage = NULL;
+        setDamageRegion = NULL;
+        historySize = 0;
+        if (hasExtension(extensions, "EGL_KHR_swap_buffers_with_damage")) {
+            swapBuffersWithDamage = (SwapBuffersWithDamageProc) egl.getProcAddress("eglSwapBuffersWithDamageKHR");
+        } else if (hasExtension(extensions, "EGL_EXT_swap_buffers_with_damage")) {
+            swapBuffersWithDamage = (SwapBuffersWithDamageProc) egl.getProcAddress("eglSwapBuffersWithDamageEXT");
+        }
+        if (hasExtension(extensions, "EGL_KHR_partial_update")) {
+            setDamageRegion = (SetDamageRegionProc) egl.getProcAddress("eglSetDamageRegionKHR");
+        }
+        LOG_INFO("Surface damage: swap %s, partial update %s.",
+            swapBuffersWithDamage != NULL ? "yes" : "no", setDamageRegion != NULL ? "yes" : "no");
+    };
+    // Called before drawing into the surface with the frame damage, as
+    // x, y, width and height from the lower left corner. Returns in region
+    // the part to redraw, which is larger when the back buffer is older
+    // than the last frame, or the whole surface when its content is lost.
+    void begin(EGLDisplay display, EGLSurface surface, const EGLint* damage,
+            int surfaceWidth, int surfaceHeight, EGLint* region) {
+        bool whole = (damage[2] >= surfaceWidth && damage[3] >= surfaceHeight);
+        region[0] = 0; region[1] = 0;
+        region[2] = surfaceWidth; region[3] = surfaceHeight;
+        if (setDamageRegion != NULL && !whole) {
+            // Back buffer holds the frame swapped age frames ago.
+            EGLint age = 0;
+            if (!egl.querySurface(display, surface, EGL_BUFFER_AGE_KHR, &age)) age = 0;
+            if (age > 0 && age - 1 <= historySize) {
+                memcpy(region, damage, sizeof(EGLint) * 4);
+                for (int i = 0; i < age - 1; ++i) unite(region, history[i]);
+            }
+            if (setDamageRegion(display, surface, region, 1) != EGL_TRUE) {
+                LOG_ERROR("Error %d setting damage region.", egl.getError());
+            }
+        }
+        // Remembers the damage for the next frames.
+        memmove(history[1], history[0], sizeof(EGLint) * 4 * (SURFACE_DAMAGE_HISTORY - 1));
+        memcpy(history[0], damage, sizeof(EGLint) * 4);
+        historySize = std::min(historySize + 1, SURFACE_DAMAGE_HISTORY);
+    };
+    // Lets the compositor skip parts of the surface which did not change.
+    EGLBoolean swap(EGLDisplay display, EGLSurface surface, const EGLint* damage) {
+        if (swapBuffersWithDamage != NULL) {
+            return swapBuffersWithDamage(display, surface, damage, 1);
+        }
+        return egl.swapBuffers(display, surface);
+    };
+private:
+    static bool hasExtension(const char* extensions, const char* name) {
+        if (extensions == NULL) return false;
+        size_t length = strlen(name);
+        const char* found = extensions;
+        // Names are separated by spaces, one may prefix another.
+        while ((found = strstr(found, name)) != NULL) {
+            bool start = (found == extensions || found[-1] == ' ');
+            bool end = (found[length] == ' ' || found[length] == '\0');
+            if (start && end) return true;
+            found += length;
+        }
+        return false;
+    };
+    static void unite(EGLint* rect, const EGLint* other) {
+        EGLint right = std::max(rect[0] + rect[2], other[0] + other[2]);
+        EGLint top = std::max(rect[1] + rect[3], other[1] + other[3]);
+        rect[0] = std::min(rect[0], other[0]);
+        rect[1] = std::min(rect[1], other[1]);
+        rect[2] = right - rect[0];
+        rect[3] = top - rect[1];
+    };
+    SurfaceDamageEGL egl;
+    SwapBuffersWithDamageProc swapBuffersWithDamage;
+    SetDamageRegionProc setDamageRegion;
+    // Damage of the last frames, most recent first.
+    EGLint history[SURFACE_DAMAGE_HISTORY][4];
+    int historySize;
+};
+
+#endif // __SURFACEDAMAGE_H__
@@ -4,24 +4,39 @@
 #include <GLES/gl.h>
 #include <png.h>
 
+#include "GLState.h"
 #include "Resource.h"
+#include "KtxFormat.h"
+#include "PixelBufferPool.h"
+#include "TextureImage.h"
+#include "TextureCache.h"
+
+#include <string>
 
 class Texture {
+    friend class TextureAtlas;
+    friend class TextureLoader;
 private:
     GLuint textureId;
     int32_t width, height;
     GLint format;
+    // Set when every pixel of the loaded image is fully opaque.
+    bool solid;
+    // Cleared while a placeholder stands for the image.
+    bool ready;
 public:
     Texture():
         textureId(0),
         width(0),
         height(0),
-        format(0) {
+        format(0),
+        solid(false),
+        ready(true) {
         //
     };
     ~Texture() {
         if (textureId != 0) {
-            glDeleteTextures(1, &textureId);
+            GLState::getInstance()->deleteTexture(textureId);
             LOG_DEBUG("Texture id:%d is dead.", textureId);
             textureId = 0;
         }
@@ -34,14 +49,10 @@ public:
     };
     status createFromData(unsigned char* pixelData, int width, int height, GLint format, int filter, int wrapMode) {
         LOG_DEBUG("Create %d x %d texture.", width, height);
-        // Creates a new OpenGL texture.
-        glGenTextures(1, &textureId);
-        glBindTexture(GL_TEXTURE_2D, textureId);
-        // Set-up texture properties.
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+        this->width = width;
+        this->height = height;
+        this->format = format;
+        generate(filter, wrapMode);
         // Loads image data into OpenGL.
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, (format == 0) ? GL_RGBA : format, GL_UNSIGNED_BYTE, pixelData);
         if (glGetError() != GL_NO_ERROR) {
@@ -51,129 +62,260 @@ public:
         LOG_DEBUG("Texture id:%d is available.", textureId);
         return STATUS_OK;
     };
-    status loadFromFile(const char* path, int filter, int wrapMode) {
+    // Image data is already compressed, as blocks of the format.
+    status createFromCompressedData(const uint8_t* data, int size, int width, int height, GLenum format, int filter, int wrapMode) {
+        LOG_DEBUG("Create %d x %d compressed texture.", width, height);
+        this->width = width;
+        this->height = height;
+        this->format = format;
+        generate(filter, wrapMode);
+        glCompressedTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, size, data);
+        if (glGetError() != GL_NO_ERROR) {
+            LOG_ERROR("Error creating compressed OpenGL texture.");
+            return STATUS_ERROR;
+        }
+        LOG_DEBUG("Texture id:%d is available.", textureId);
+        return STATUS_OK;
+    };
+    // Loads the KTX file next to the image instead, when its format is
+    // in compression, the TEXTURE_COMPRESSION_* supported by the GPU.
+    status loadFromFile(const char* path, int filter, int wrapMode, int compression = 0) {
+        if (compression != 0 && loadKTXImage(path, filter, wrapMode, compression) == STATUS_OK) return STATUS_OK;
         uint8_t* pixelData = loadPNGImage(path);
         if (pixelData == NULL) return STATUS_ERROR;
         status result = createFromData(pixelData, width, height, format, filter, wrapMode);
-        SAFE_DELETE(pixelData);
+        PixelBufferPool::getInstance()->release(pixelData);
         return result;
     };
+    // Loads the KTX file next to the image only, compressed images are
+    // uploaded as they are read.
+    status loadCompressed(const char* path, int filter, int wrapMode, int compression) {
+        if (compression == 0) return STATUS_ERROR;
+        return loadKTXImage(path, filter, wrapMode, compression);
+    };
+    // Transparent texture of one pixel standing for the image until it is
+    // decoded, its size is read from the PNG header so that texture
+    // coordinates are already right.
+    status createPlaceholder(const char* path, int filter, int wrapMode) {
+        static const unsigned char pixel[4] = { 0, 0, 0, 0 };
+        if (readPNGSize(path, width, height) != STATUS_OK) {
+            LOG_ERROR("Error while reading PNG header");
+            return STATUS_ERROR;
+        }
+        format = GL_RGBA;
+        solid = false;
+        ready = false;
+        generate(filter, wrapMode);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        if (glGetError() != GL_NO_ERROR) {
+            LOG_ERROR("Error creating OpenGL texture.");
+            return STATUS_ERROR;
+        }
+        LOG_DEBUG("Texture id:%d is a placeholder.", textureId);
+        return STATUS_OK;
+    };
+    // Replaces the placeholder with the decoded image, whose pixels are
+    // released.
+    status upload(TextureImage& image) {
+        width = image.width;
+        height = image.height;
+        format = image.format;
+        solid = image.solid;
+        ready = true;
+        GLState::getInstance()->bindTexture(0, textureId);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+        PixelBufferPool::getInstance()->release(image.pixels);
+        image.pixels = NULL;
+        if (glGetError() != GL_NO_ERROR) {
+            LOG_ERROR("Error uploading OpenGL texture.");
+            return STATUS_ERROR;
+        }
+        LOG_DEBUG("Texture id:%d is available.", textureId);
+        return STATUS_OK;
+    };
+    // Replaces a part of the texture image.
+    status update(unsigned char* pixelData, int x, int y, int width, int height) {
+        GLState::getInstance()->bindTexture(0, textureId);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, (format == 0) ? GL_RGBA : format, GL_UNSIGNED_BYTE, pixelData);
+        if (glGetError() != GL_NO_ERROR) {
+            LOG_ERROR("Error updating OpenGL texture.");
+            return STATUS_ERROR;
+        }
+        return STATUS_OK;
+    };
     void apply() {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureId);
+        GLState::getInstance()->bindTexture(0, textureId);
     };
     GLuint getTextureId() {
         return textureId;
     };
+    bool isSolid() {
+        return solid;
+    };
+    bool isReady() {
+        return ready;
+    };
+    // Image size from the PNG header, without decoding.
+    static status readPNGSize(const char* path, int32_t& width, int32_t& height) {
+        Resource resource(path);
+        png_byte header[24];
+        status result = STATUS_ERROR;
+        // Signature is followed by the IHDR chunk, width and height first.
+        if (resource.open() == STATUS_OK && resource.read(header, sizeof(header)) == STATUS_OK
+                && png_sig_cmp(header, 0, 8) == 0) {
+            width = png_get_uint_32(header + 16);
+            height = png_get_uint_32(header + 20);
+            result = (width > 0 && height > 0) ? STATUS_OK : STATUS_ERROR;
+        }
+        resource.close();
+        return result;
+    };
 protected:
+    status loadKTXImage(const char* path, int filter, int wrapMode, int compression) {
+        // Compressed image of "textures/Image.png" is "textures/Image.ktx".
+        std::string ktxPath(path);
+        size_t extension = ktxPath.rfind('.');
+        if (extension != std::string::npos) ktxPath.erase(extension);
+        ktxPath += KTX_EXTENSION;
+        Resource resource(ktxPath.c_str());
+        const uint8_t* data = (const uint8_t*) resource.map();
+        if (data == NULL) return STATUS_ERROR;
+        LOG_INFO("Loading texture: %s", resource.getPath());
+        off_t length = resource.getLength();
+        const KtxHeader* header = (const KtxHeader*) data;
+        const uint8_t* image;
+        uint32_t imageSize;
+        status result;
+        if (length < (off_t)sizeof(KtxHeader) || memcmp(header->identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0
+                || header->endianness != KTX_ENDIANNESS) goto ERROR;
+        // Unsupported formats fall back to the PNG image.
+        if (ktxBlockSize(header->glInternalFormat) == 0 || (ktxCompression(header->glInternalFormat) & compression) == 0) {
+            LOG_DEBUG("Compressed format 0x%x is not supported.", header->glInternalFormat);
+            resource.close();
+            return STATUS_ERROR;
+        }
+        // Only the first level is uploaded.
+        image = data + sizeof(KtxHeader) + header->bytesOfKeyValueData;
+        if (image + sizeof(uint32_t) > data + length) goto ERROR;
+        imageSize = *(const uint32_t*) image;
+        image += sizeof(uint32_t);
+        if (imageSize != ktxImageSize(header->glInternalFormat, header->pixelWidth, header->pixelHeight)
+                || image + imageSize > data + length) goto ERROR;
+        result = createFromCompressedData(image, imageSize, header->pixelWidth, header->pixelHeight,
+            header->glInternalFormat, filter, wrapMode);
+        // Encoder keeps ETC1 for images without transparency.
+        solid = (header->glInternalFormat == GL_ETC1_RGB8_OES);
+        resource.close();
+        return result;
+ERROR:
+        LOG_ERROR("Error while reading KTX file");
+        resource.close();
+        return STATUS_ERROR;
+    };
     unsigned char* loadPNGImage(const char* path) {
+        TextureImage image;
+        if (decodePNGImage(path, image) != STATUS_OK) return NULL;
+        width = image.width;
+        height = image.height;
+        format = image.format;
+        solid = image.solid;
+        return image.pixels;
+    };
+    // Decodes into image, may run on any thread. PNG is read in place
+    // from the mapped asset and pixels are written into a pooled buffer,
+    // released once uploaded. Pixels decoded by an earlier launch are
+    // read from the texture cache instead, without reading the PNG.
+    static status decodePNGImage(const char* path, TextureImage& image) {
         Resource resource(path);
-        LOG_INFO("Loading texture: %s", resource.getPath());
-        png_byte header[8];
-        png_structp pngPtr = NULL;
-        png_infop infoPtr = NULL;
-        png_byte* imageBuffer = NULL;
-        png_bytep* rowPtrs = NULL;
-        png_int_32 rowSize;
-        bool transparency;
-        // Opens and checks image signature (first 8 bytes).
+        png_image png;
+        const uint8_t* data = NULL;
+        size_t length = 0;
+        memset(&png, 0, sizeof(png));
+        png.version = PNG_IMAGE_VERSION;
+        image.pixels = NULL;
         if (resource.open() != STATUS_OK) goto ERROR;
-        if (resource.read(header, sizeof(header)) != STATUS_OK) goto ERROR;
-        if (png_sig_cmp(header, 0, 8) != 0) goto ERROR;
-        // Creates required structures.
-        pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-        if (!pngPtr) goto ERROR;
-        infoPtr = png_create_info_struct(pngPtr);
-        if (!infoPtr) goto ERROR;
-        // Prepares reading operation by setting-up a read callback.
-        png_set_read_fn(pngPtr, &resource, callback_read);
-        // Set-up error management. If an error occurs while reading,
-        // code will come back here and jump.
-        if (setjmp(png_jmpbuf(pngPtr))) goto ERROR;
-        // Ignores first 8 bytes already read and processes header.
-        png_set_sig_bytes(pngPtr, 8);
-        png_read_info(pngPtr, infoPtr);
-        // Retrieves PNG info and updates PNG struct accordingly.
-        png_int_32 depth, colorType;
-        png_uint_32 pngWidth, pngHeight;
-        png_get_IHDR(pngPtr, infoPtr, &pngWidth, &pngHeight, &depth, &colorType, NULL, NULL, NULL);
-        width = pngWidth;
-        height = pngHeight;
-        // Creates a full alpha channel if transparency is encoded as
-        // an array of palette entries or a single transparent color.
-        transparency = false;
-        if (png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS)) {
-            png_set_tRNS_to_alpha(pngPtr);
-            transparency = true;
-            goto ERROR;
-        }
-        // Expands PNG with less than 8bits per channel to 8bits.
-        if (depth < 8) {
-            png_set_packing (pngPtr);
-            // Shrinks PNG with 16bits per color channel down to 8bits.
-        } else if (depth == 16) {
-            png_set_strip_16(pngPtr);
-        }
-        // Indicates that image needs conversion to RGBA if needed.
-        switch (colorType) {
-            case PNG_COLOR_TYPE_PALETTE:
-                png_set_palette_to_rgb(pngPtr);
-                format = transparency ? GL_RGBA : GL_RGB;
-                break;
-            case PNG_COLOR_TYPE_RGB:
-                format = transparency ? GL_RGBA : GL_RGB;
+        length = resource.getLength();
+        resource.close();
+        if (TextureCache::read(path, length, image) == STATUS_OK) return STATUS_OK;
+        data = (const uint8_t*) resource.map();
+        if (data == NULL) goto ERROR;
+        LOG_INFO("Loading texture: %s", resource.getPath());
+        if (!png_image_begin_read_from_memory(&png, data, length)) goto ERROR;
+        // Keeps the channels of the image, palettes are expanded and
+        // transparency adds an alpha channel.
+        switch (png.format & (PNG_FORMAT_FLAG_COLOR | PNG_FORMAT_FLAG_ALPHA)) {
+            case PNG_FORMAT_FLAG_COLOR | PNG_FORMAT_FLAG_ALPHA:
+                png.format = PNG_FORMAT_RGBA;
+                image.format = GL_RGBA;
                 break;
-            case PNG_COLOR_TYPE_RGBA:
-                format = GL_RGBA;
+            case PNG_FORMAT_FLAG_COLOR:
+                png.format = PNG_FORMAT_RGB;
+                image.format = GL_RGB;
                 break;
-            case PNG_COLOR_TYPE_GRAY:
-                png_set_expand_gray_1_2_4_to_8(pngPtr);
-                format = transparency ? GL_LUMINANCE_ALPHA:GL_LUMINANCE;
+            case PNG_FORMAT_FLAG_ALPHA:
+                png.format = PNG_FORMAT_GA;
+                image.format = GL_LUMINANCE_ALPHA;
                 break;
-            case PNG_COLOR_TYPE_GA:
-                png_set_expand_gray_1_2_4_to_8(pngPtr);
-                format = GL_LUMINANCE_ALPHA;
+            default:
+                png.format = PNG_FORMAT_GRAY;
+                image.format = GL_LUMINANCE;
                 break;
         }
-        // Validates all tranformations.
-        png_read_update_info(pngPtr, infoPtr);
-        // Get row size in bytes.
-        rowSize = png_get_rowbytes(pngPtr, infoPtr);
-        if (rowSize <= 0) goto ERROR;
-        // Ceates the image buffer that will be sent to OpenGL.
-        imageBuffer = new png_byte[rowSize * height];
-        if (!imageBuffer) goto ERROR;
-        // Pointers to each row of the image buffer. Row order is
-        // inverted because different coordinate systems are used by
-        // OpenGL (1st pixel is at bottom left) and PNGs (top-left).
-        rowPtrs = new png_bytep[height];
-        if (!rowPtrs) goto ERROR;
-        for (int32_t i = 0; i < height; ++i) {
-            rowPtrs[height - (i + 1)] = imageBuffer + i * rowSize;
-        }
-        // Reads image content.
-        png_read_image(pngPtr, rowPtrs);
-        // Frees memory and resources.
+        image.width = png.width;
+        image.height = png.height;
+        image.pixels = PixelBufferPool::getInstance()->acquire(PNG_IMAGE_SIZE(png));
+        // Row order is inverted because different coordinate systems are
+        // used by OpenGL (1st pixel is at bottom left) and PNGs (top-left).
+        if (!png_image_finish_read(&png, NULL, image.pixels, -(png_int_32)PNG_IMAGE_ROW_STRIDE(png), NULL)) goto ERROR;
+        image.solid = checkSolid(image.pixels, PNG_IMAGE_SIZE(png), image.format);
         resource.close();
-        png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
-        SAFE_DELETE(rowPtrs);
-        return imageBuffer;
+        TextureCache::write(path, length, image);
+        return STATUS_OK;
 ERROR:
-        LOG_ERROR("Error while reading PNG file");
+        LOG_ERROR("Error while reading PNG file: %s", png.message);
+        png_image_free(&png);
+        PixelBufferPool::getInstance()->release(image.pixels);
+        image.pixels = NULL;
         resource.close();
-        SAFE_DELETE(rowPtrs);
-        SAFE_DELETE(imageBuffer);
-        if (pngPtr != NULL) {
-            png_infop* infoPtrP = (infoPtr != NULL) ? &infoPtr : NULL;
-            png_destroy_read_struct(&pngPtr, infoPtrP, NULL);
-        }
-        return NULL;
+        return STATUS_ERROR;
     };
 private:
-    static void callback_read(png_structp pngPtr, png_bytep data, png_size_t length) {
-        Resource* resource = ((Resource*) png_get_io_ptr(pngPtr));
-        if (resource->read(data, length) != STATUS_OK) resource->close();
-    }
+    // Creates a new OpenGL texture and sets its properties.
+    void generate(int filter, int wrapMode) {
+        glGenTextures(1, &textureId);
+        GLState::getInstance()->bindTexture(0, textureId);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+    };
+    // Images without alpha channel are solid, others when no pixel is
+    // transparent.
+    static bool checkSolid(const unsigned char* pixelData, int size, GLint format) {
+        int stride;
+        switch (format) {
+            case GL_RGBA: stride = 4; break;
+            case GL_LUMINANCE_ALPHA: stride = 2; break;
+            default: return true;
+        }
+        for (int i = stride - 1; i < size; i += stride) {
+            if (pixelData[i] != 0xFF) return false;
+        }
+        return true;
+    };
+};
+
+struct AtlasFrame;
+
+// Rectangle inside a texture, in pixels.
+struct TextureRegion {
+    Texture* texture;
+    int x, y, width, height;
+    // Trimmed frames of a prebuilt atlas sheet.
+    const AtlasFrame* frames;
+    int frameCount;
+    // No pixel of the region is transparent.
+    bool solid;
 };
 
 #endif // __TEXTURE_H__
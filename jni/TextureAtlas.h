@@ -0,0 +1,160 @@
+#ifndef __TEXTUREATLAS_H__
+#define __TEXTUREATLAS_H__
+
+/* Packs registered images into shared texture pages */
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Texture.h"
+#include "AtlasPacker.h"
+
+const int ATLAS_PAGE_SIZE = 1024;
+// Texels around each image, filled with its edge texels so that filtering
+// never samples a neighbour.
+const int ATLAS_PADDING = 2;
+
+class TextureAtlas {
+public:
+    TextureAtlas():
+        pending(),
+        regions(),
+        excluded(),
+        pages(),
+        packers() {
+        //
+    };
+    ~TextureAtlas() {
+        reset();
+    };
+    // Queues image to be packed on the next lookup.
+    void registerImage(const char* path) {
+        if (regions.find(path) != regions.end()) return;
+        if (excluded.find(path) != excluded.end()) return;
+        if (std::find(pending.begin(), pending.end(), path) != pending.end()) return;
+        pending.push_back(path);
+    };
+    // Returns false if image is not part of the atlas.
+    bool findRegion(const char* path, TextureRegion& region) {
+        if (std::find(pending.begin(), pending.end(), path) != pending.end()) pack();
+        std::map<std::string, TextureRegion>::iterator it = regions.find(path);
+        if (it == regions.end()) return false;
+        region = it->second;
+        return true;
+    };
+    // Releases pages, images will be packed again on demand.
+    void unload() {
+        for (std::map<std::string, TextureRegion>::iterator it = regions.begin(); it != regions.end(); ++it) {
+            pending.push_back(it->first);
+        }
+        regions.clear();
+        for (std::vector<Texture*>::iterator it = pages.begin(); it < pages.end(); ++it) {
+            SAFE_DELETE(*it);
+        }
+        pages.clear();
+        for (std::vector<AtlasPacker*>::iterator it = packers.begin(); it < packers.end(); ++it) {
+            SAFE_DELETE(*it);
+        }
+        packers.clear();
+    };
+    void reset() {
+        unload();
+        pending.clear();
+        excluded.clear();
+    };
+private:
+    struct Image {
+        std::string path;
+        unsigned char* pixelData;
+        int width, height;
+        bool solid;
+    };
+    static bool compareHeight(const Image& a, const Image& b) {
+        return a.height > b.height;
+    };
+    void pack() {
+        GLint maxSize;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        int pageSize = std::min((int)maxSize, ATLAS_PAGE_SIZE);
+        // Decodes all pending images.
+        std::vector<Image> images;
+        for (std::vector<std::string>::iterator it = pending.begin(); it < pending.end(); ++it) {
+            Texture decoder;
+            Image image = { *it, decoder.loadPNGImage(it->c_str()), decoder.width, decoder.height, decoder.solid };
+            // Keeps images that do not fit the page format standalone.
+            if (image.pixelData == NULL || decoder.format != GL_RGBA ||
+                image.width + 2 * ATLAS_PADDING > pageSize || image.height + 2 * ATLAS_PADDING > pageSize) {
+                LOG_DEBUG("Image %s is not packed.", it->c_str());
+                PixelBufferPool::getInstance()->release(image.pixelData);
+                excluded.insert(*it);
+                continue;
+            }
+            images.push_back(image);
+        }
+        pending.clear();
+        // Places highest images first, it keeps the skyline flat.
+        std::stable_sort(images.begin(), images.end(), compareHeight);
+        std::vector<unsigned char> padded;
+        for (std::vector<Image>::iterator it = images.begin(); it < images.end(); ++it) {
+            int x = 0, y = 0;
+            size_t page = 0;
+            for (; page < packers.size(); ++page) {
+                if (packers[page]->insert(it->width + 2 * ATLAS_PADDING, it->height + 2 * ATLAS_PADDING, x, y)) break;
+            }
+            if (page == packers.size()) {
+                if (addPage(pageSize) != STATUS_OK) {
+                    excluded.insert(it->path);
+                    PixelBufferPool::getInstance()->release(it->pixelData);
+                    continue;
+                }
+                packers[page]->insert(it->width + 2 * ATLAS_PADDING, it->height + 2 * ATLAS_PADDING, x, y);
+            }
+            // Region is the image inside of its padding.
+            extrude(*it, padded);
+            pages[page]->update(&padded[0], x, y, it->width + 2 * ATLAS_PADDING, it->height + 2 * ATLAS_PADDING);
+            TextureRegion region = { pages[page], x + ATLAS_PADDING, y + ATLAS_PADDING, it->width, it->height, NULL, 0, it->solid };
+            regions[it->path] = region;
+            PixelBufferPool::getInstance()->release(it->pixelData);
+        }
+        LOG_INFO("Texture atlas has %d images in %d pages.", regions.size(), pages.size());
+    };
+    // Copies RGBA image into the middle of padded, its edge texels are
+    // repeated into the padding.
+    static void extrude(const Image& image, std::vector<unsigned char>& padded) {
+        int paddedWidth = image.width + 2 * ATLAS_PADDING;
+        int paddedHeight = image.height + 2 * ATLAS_PADDING;
+        padded.resize(paddedWidth * paddedHeight * 4);
+        for (int y = 0; y < paddedHeight; ++y) {
+            int sourceY = CLAMP(y - ATLAS_PADDING, 0, image.height - 1);
+            const unsigned char* source = image.pixelData + sourceY * image.width * 4;
+            unsigned char* row = &padded[y * paddedWidth * 4];
+            for (int x = 0; x < ATLAS_PADDING; ++x) {
+                memcpy(row + x * 4, source, 4);
+                memcpy(row + (ATLAS_PADDING + image.width + x) * 4, source + (image.width - 1) * 4, 4);
+            }
+            memcpy(row + ATLAS_PADDING * 4, source, image.width * 4);
+        }
+    };
+    status addPage(int pageSize) {
+        // Starts with transparent page, space left between images stays empty.
+        std::vector<unsigned char> blank(pageSize * pageSize * 4, 0);
+        Texture* page = new Texture();
+        if (page->createFromData(&blank[0], pageSize, pageSize, GL_RGBA, GL_LINEAR, GL_CLAMP_TO_EDGE) != STATUS_OK) {
+            SAFE_DELETE(page);
+            return STATUS_ERROR;
+        }
+        pages.push_back(page);
+        packers.push_back(new AtlasPacker(pageSize, pageSize));
+        return STATUS_OK;
+    };
+    std::vector<std::string> pending;
+    std::map<std::string, TextureRegion> regions;
+    std::set<std::string> excluded;
+    std::vector<Texture*> pages;
+    std::vector<AtlasPacker*> packers;
+};
+
+#endif // __TEXTUREATLAS_H__
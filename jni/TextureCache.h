@@ -0,0 +1,173 @@
+#ifndef __TEXTURECACHE_H__
+#define __TEXTURECACHE_H__
+
+/* Decoded images kept in internal storage, for faster next launches */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "PixelBufferPool.h"
+#include "TextureImage.h"
+
+// File layout: header, then the pixels ready to be uploaded. Entries are
+// named after the asset path and are only used for a source image of the
+// same size in the same install of the package.
+const uint32_t TEXTURE_CACHE_MAGIC = 0x58544354; // "TCTX"
+const uint32_t TEXTURE_CACHE_VERSION = 2;
+const char* const TEXTURE_CACHE_DIRECTORY = "textures";
+const char* const TEXTURE_CACHE_EXTENSION = ".tex";
+// Images decoding to more than this times their source size are not
+// cached, their entries would cost more storage than decoding saves.
+const size_t TEXTURE_CACHE_MAX_GROWTH = 16;
+
+struct TextureCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    // Package install and source image the pixels were decoded from.
+    uint64_t packageTime;
+    uint32_t sourceSize;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t solid;
+};
+
+// Entries are read and written by the decoding threads, each image by
+// one thread at a time.
+class TextureCache {
+public:
+    // Reads when the package was installed or updated, on the main thread
+    // before images are decoded. The cache is not used when it is unknown.
+    static void initialize() {
+        JNIEnv* jni;
+        application->activity->vm->AttachCurrentThread(&jni, NULL);
+        jobject activity = application->activity->clazz;
+        jclass activityClass = jni->GetObjectClass(activity);
+        jmethodID getPackageManager = jni->GetMethodID(activityClass, "getPackageManager", "()Landroid/content/pm/PackageManager;");
+        jmethodID getPackageName = jni->GetMethodID(activityClass, "getPackageName", "()Ljava/lang/String;");
+        jobject packageManager = jni->CallObjectMethod(activity, getPackageManager);
+        jobject packageName = jni->CallObjectMethod(activity, getPackageName);
+        jclass managerClass = jni->GetObjectClass(packageManager);
+        jmethodID getPackageInfo = jni->GetMethodID(managerClass, "getPackageInfo",
+            "(Ljava/lang/String;I)Landroid/content/pm/PackageInfo;");
+        jobject packageInfo = jni->CallObjectMethod(packageManager, getPackageInfo, packageName, 0);
+        if (jni->ExceptionCheck()) {
+            jni->ExceptionClear();
+            packageInfo = NULL;
+        }
+        if (packageInfo != NULL) {
+            jfieldID lastUpdateTime = jni->GetFieldID(jni->GetObjectClass(packageInfo), "lastUpdateTime", "J");
+            getPackageTime() = (uint64_t) jni->GetLongField(packageInfo, lastUpdateTime);
+        }
+        application->activity->vm->DetachCurrentThread();
+        LOG_DEBUG("Texture cache package time: %llu", (unsigned long long) getPackageTime());
+    };
+    // Reads the pixels of the source image into a pooled buffer, when
+    // they were cached. Only the size of the source is needed.
+    static status read(const char* path, size_t sourceSize, TextureImage& image) {
+        std::string cachePath;
+        if (getPackageTime() == 0 || getPath(path, cachePath) != STATUS_OK) return STATUS_ERROR;
+        int file = open(cachePath.c_str(), O_RDONLY);
+        if (file < 0) return STATUS_ERROR;
+        TextureCacheHeader header;
+        struct stat sb;
+        size_t size;
+        image.pixels = NULL;
+        if (readAll(file, &header, sizeof(header)) != STATUS_OK || header.magic != TEXTURE_CACHE_MAGIC
+                || header.version != TEXTURE_CACHE_VERSION || header.packageTime != getPackageTime()
+                || header.sourceSize != sourceSize) goto ERROR;
+        image.width = header.width;
+        image.height = header.height;
+        image.format = header.format;
+        image.solid = (header.solid != 0);
+        size = textureImageSize(image);
+        if (fstat(file, &sb) != 0 || sb.st_size != (off_t)(sizeof(header) + size)) goto ERROR;
+        image.pixels = PixelBufferPool::getInstance()->acquire(size);
+        if (readAll(file, image.pixels, size) != STATUS_OK) goto ERROR;
+        close(file);
+        LOG_DEBUG("Texture %s is cached.", path);
+        return STATUS_OK;
+ERROR:
+        // Stale entry is replaced once the image is decoded.
+        PixelBufferPool::getInstance()->release(image.pixels);
+        image.pixels = NULL;
+        close(file);
+        return STATUS_ERROR;
+    };
+    // Writes a temporary file renamed over the entry, so that an entry is
+    // never seen partly written.
+    static void write(const char* path, size_t sourceSize, const TextureImage& image) {
+        std::string cachePath;
+        if (getPackageTime() == 0 || (size_t)textureImageSize(image) > sourceSize * TEXTURE_CACHE_MAX_GROWTH) return;
+        if (getPath(path, cachePath) != STATUS_OK) return;
+        std::string temporaryPath = cachePath + ".tmp";
+        TextureCacheHeader header = { TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION, getPackageTime(), (uint32_t)sourceSize,
+            (uint32_t)image.width, (uint32_t)image.height, (uint32_t)image.format, image.solid ? 1u : 0u };
+        int file = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0660);
+        if (file < 0) goto ERROR;
+        if (writeAll(file, &header, sizeof(header)) != STATUS_OK
+                || writeAll(file, image.pixels, textureImageSize(image)) != STATUS_OK) {
+            close(file);
+            unlink(temporaryPath.c_str());
+            goto ERROR;
+        }
+        if (close(file) != 0 || rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+            unlink(temporaryPath.c_str());
+            goto ERROR;
+        }
+        return;
+ERROR:
+        LOG_ERROR("Error while caching texture %s: %s", path, strerror(errno));
+    };
+private:
+    // Set once by initialize, before the decoding threads read it.
+    static uint64_t& getPackageTime() {
+        static uint64_t packageTime = 0;
+        return packageTime;
+    };
+    // Entry of "textures/Image.png" is "<internal>/textures/textures_Image.png.tex".
+    static status getPath(const char* path, std::string& cachePath) {
+        const char* internalPath = application->activity->internalDataPath;
+        if (internalPath == NULL) return STATUS_ERROR;
+        cachePath = internalPath;
+        // Created with its parent on first use.
+        if (mkdir(internalPath, 0770) != 0 && errno != EEXIST) return STATUS_ERROR;
+        cachePath.append("/").append(TEXTURE_CACHE_DIRECTORY);
+        if (mkdir(cachePath.c_str(), 0770) != 0 && errno != EEXIST) return STATUS_ERROR;
+        cachePath.append("/");
+        for (const char* c = path; *c != '\0'; ++c) {
+            cachePath.push_back(*c == '/' ? '_' : *c);
+        }
+        cachePath.append(TEXTURE_CACHE_EXTENSION);
+        return STATUS_OK;
+    };
+    static status readAll(int file, void* buffer, size_t size) {
+        uint8_t* data = (uint8_t*) buffer;
+        while (size > 0) {
+            ssize_t count = ::read(file, data, size);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) return STATUS_ERROR;
+            data += count;
+            size -= count;
+        }
+        return STATUS_OK;
+    };
+    static status writeAll(int file, const void* buffer, size_t size) {
+        const uint8_t* data = (const uint8_t*) buffer;
+        while (size > 0) {
+            ssize_t count = ::write(file, data, size);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) return STATUS_ERROR;
+            data += count;
+            size -= count;
+        }
+        return STATUS_OK;
+    };
+};
+
+#endif // __TEXTURECACHE_H__
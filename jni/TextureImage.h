@@ -0,0 +1,29 @@
+#ifndef __TEXTUREIMAGE_H__
+#define __TEXTUREIMAGE_H__
+
+#include <GLES2/gl2.h>
+#include <stdint.h>
+
+// Decoded image, waiting to be uploaded. Rows are bottom-up.
+struct TextureImage {
+    unsigned char* pixels;
+    int32_t width, height;
+    GLint format;
+    bool solid;
+};
+
+// Bytes of a pixel of the format.
+inline int texturePixelSize(GLint format) {
+    switch (format) {
+        case GL_RGBA: return 4;
+        case GL_RGB: return 3;
+        case GL_LUMINANCE_ALPHA: return 2;
+    }
+    return 1;
+};
+
+inline int textureImageSize(const TextureImage& image) {
+    return image.width * image.height * texturePixelSize(image.format);
+};
+
+#endif // __TEXTUREIMAGE_H__
@@ -0,0 +1,150 @@
+#ifndef __TEXTURELOADER_H__
+#define __TEXTURELOADER_H__
+
+/* Decodes texture images on worker threads */
+
+#include <limits.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Texture.h"
+
+// Workers are taken from the cores left to the main thread.
+const int TEXTURE_LOADER_MAX_WORKERS = 3;
+// Bytes uploaded to OpenGL in one frame.
+const int DEFAULT_TEXTURE_UPLOAD_BUDGET = 4 * 1024 * 1024;
+
+// Textures are submitted with a placeholder, decoded by the workers and
+// uploaded by the main thread, which owns the OpenGL context.
+class TextureLoader {
+public:
+    TextureLoader():
+        workers(), mutex(), condition(), finishedCondition(),
+        jobs(), finished(), busy(0), quit(false) {
+        //
+    };
+    ~TextureLoader() {
+        stop();
+    };
+    void submit(Texture* texture, const char* path) {
+        if (workers.empty()) start();
+        TextureJob job = { texture, path, { NULL, 0, 0, 0, false } };
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(job);
+        }
+        condition.notify_one();
+    };
+    // True while a submitted texture is not uploaded yet.
+    bool isLoading() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !jobs.empty() || !finished.empty() || busy > 0;
+    };
+    // Uploads decoded images while they fit in the budget, at least one
+    // so that large images are not held back. Returns the upload count.
+    int update(int budget) {
+        int count = 0;
+        while (true) {
+            TextureJob job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (finished.empty()) break;
+                int size = textureImageSize(finished.front().image);
+                if (count > 0 && size > budget) break;
+                budget -= size;
+                job = finished.front();
+                finished.pop_front();
+            }
+            upload(job);
+            ++count;
+        }
+        return count;
+    };
+    // Blocks until every submitted texture is decoded, then uploads them.
+    int wait() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finishedCondition.wait(lock, [this] { return jobs.empty() && busy == 0; });
+        }
+        return update(INT_MAX);
+    };
+    // Forgets submitted textures, before they are released. Images being
+    // decoded are waited for.
+    void cancel() {
+        std::deque<TextureJob> dropped;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobs.clear();
+            finishedCondition.wait(lock, [this] { return busy == 0; });
+            dropped.swap(finished);
+        }
+        for (std::deque<TextureJob>::iterator it = dropped.begin(); it != dropped.end(); ++it) {
+            PixelBufferPool::getInstance()->release(it->image.pixels);
+        }
+    };
+    void stop() {
+        cancel();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        condition.notify_all();
+        for (std::vector<std::thread>::iterator it = workers.begin(); it < workers.end(); ++it) {
+            it->join();
+        }
+        workers.clear();
+        quit = false;
+    };
+private:
+    struct TextureJob {
+        Texture* texture;
+        const char* path;
+        TextureImage image;
+    };
+    void start() {
+        int count = (int)std::thread::hardware_concurrency() - 1;
+        count = std::max(1, std::min(count, TEXTURE_LOADER_MAX_WORKERS));
+        LOG_DEBUG("Starting %d texture workers.", count);
+        for (int i = 0; i < count; ++i) {
+            workers.push_back(std::thread(&TextureLoader::run, this));
+        }
+    };
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            condition.wait(lock, [this] { return quit || !jobs.empty(); });
+            if (quit) return;
+            TextureJob job = jobs.front();
+            jobs.pop_front();
+            ++busy;
+            lock.unlock();
+            Texture::decodePNGImage(job.path, job.image);
+            lock.lock();
+            --busy;
+            // Broken images keep their placeholder.
+            if (job.image.pixels != NULL) finished.push_back(job);
+            if (jobs.empty() && busy == 0) finishedCondition.notify_all();
+        }
+    };
+    void upload(TextureJob& job) {
+        if (job.texture->upload(job.image) != STATUS_OK) {
+            LOG_ERROR("Error while uploading texture: %s", job.path);
+        }
+    };
+    std::vector<std::thread> workers;
+    // Queues shared with the workers, guarded by the mutex.
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::condition_variable finishedCondition;
+    std::deque<TextureJob> jobs;
+    std::deque<TextureJob> finished;
+    int busy;
+    bool quit;
+};
+
+#endif // __TEXTURELOADER_H__
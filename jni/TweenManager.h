@@ -80,6 +80,13 @@ public:
         }
         tweens.clear();
     };
+    // True when no tween is playing, delayed ones included.
+    bool isIdle() {
+        for (std::list<Tween*>::iterator it = tweens.begin(); it != tweens.end(); ++it) {
+            if ((*it)->getPlaying()) return false;
+        }
+        return true;
+    };
     // Debug.
     int getTweensCount() {
         return tweens.size();
@@ -12,7 +12,8 @@ private:
 public:
     Gameplay(Activity* activity):
         Scene(),
-        activity(activity) {
+        activity(activity),
+        particleSystem(NULL) {
         LOG_INFO("Create Gameplay scene.");
     };
     ~Gameplay() {
@@ -27,13 +28,35 @@ public:
         if (created) return STATUS_OK;
         LOG_DEBUG("Start Gameplay scene.");
         spriteBatch = new SpriteBatch();
+        const char* atlasImages[] = {
+            "textures/Background.png",
+            "textures/GameBox.png",
+            "textures/Leafs.png",
+            "textures/AppleFruit.png",
+            "textures/BannanaFruit.png",
+            "textures/CarrotFruit.png",
+            "textures/GrapesFruit.png",
+            "textures/OrangeFruit.png",
+            "textures/PearFruit.png",
+            "textures/TomatoFruit.png",
+            "textures/CherryFruit.png",
+            "textures/RedishFruit.png",
+            "textures/LemonFruit.png",
+            "textures/ChilliFruit.png",
+            "textures/Particle.png",
+            "textures/AccentForBonus.png",
+            "textures/ExtraFruitCreate.png",
+            "textures/ExtraFruitKill.png",
+            "textures/MatchStepBonus.png"
+        };
+        registerAtlasImages(atlasImages);
         float renderWidth = (float)GraphicsManager::getInstance()->getRenderWidth();
         float renderHeight = (float)GraphicsManager::getInstance()->getRenderHeight();
         float halfWidth = renderWidth / 2;
         float halfHeight = renderHeight / 2;
-        background = addBackground("textures/Background.png", 360, 640, Vector2(halfWidth, halfHeight));
+        background = addStaticBackground("textures/Background.png", 360, 640, Vector2(halfWidth, halfHeight));
         gameBox = addBackground("textures/GameBox.png", 360, 380, Vector2(halfWidth, halfHeight));
-        gameBox->sprite->opaque = 0.0f;
+        gameBox->sprite->setOpaque(0.0f);
         TweenManager::getInstance()->addTween(gameBox->sprite, TweenType::OPAQUE, 0.7f, Ease::Sinusoidal::InOut)
             ->target(1.0f)->remove(true)->start();
         TweenManager::getInstance()->addTween(gameBox->sprite, TweenType::SCALE_X, 0.37f, Ease::Sinusoidal::InOut)
@@ -48,8 +71,8 @@ public:
             //
             leaf01 = addBackground("textures/Leafs.png", 327, 287, Vector2(renderWidth - 105.0f, 90.0f));
             leaf01->sprite->setFrame(0);
-            leaf01->sprite->order = 1;
-            leaf01->sprite->pivot = Vector(162.0f, -142.0f, 0.0f);
+            leaf01->sprite->setOrder(1);
+            leaf01->sprite->setPivot(Vector(162.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf01->sprite);
             //  ____
             // |   |
@@ -57,8 +80,8 @@ public:
             //
             leaf02 = addBackground("textures/Leafs.png", 327, 287, Vector2(30.0f, 30.0f));
             leaf02->sprite->setFrame(1);
-            leaf02->sprite->order = 1;
-            leaf02->sprite->pivot = Vector(-162.0f, -142.0f, 0.0f);
+            leaf02->sprite->setOrder(1);
+            leaf02->sprite->setPivot(Vector(-162.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf02->sprite);
             //  ____
             // |   |
@@ -66,8 +89,8 @@ public:
             //
             leaf03 = addBackground("textures/Leafs.png", 327, 287, Vector2(halfWidth + 35.0f, 40.0f));
             leaf03->sprite->setFrame(2);
-            leaf03->sprite->order = 0;
-            leaf03->sprite->pivot = Vector(0.0f, -142.0f, 0.0f);
+            leaf03->sprite->setOrder(0);
+            leaf03->sprite->setPivot(Vector(0.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf03->sprite);
             //  ____
             // |·  |
@@ -75,8 +98,8 @@ public:
             //
             leaf04 = addBackground("textures/Leafs.png", 327, 287, Vector2(130.0f, renderHeight - 120.0f));
             leaf04->sprite->setFrame(3);
-            leaf04->sprite->order = 1;
-            leaf04->sprite->pivot = Vector(-162.0f, 142.0f, 0.0f);
+            leaf04->sprite->setOrder(1);
+            leaf04->sprite->setPivot(Vector(-162.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf04->sprite);
             //  ____
             // |  ·|
@@ -84,8 +107,8 @@ public:
             //
             leaf05 = addBackground("textures/Leafs.png", 327, 287, Vector2(renderWidth - 10.0f, renderHeight - 60.0f));
             leaf05->sprite->setFrame(4);
-            leaf05->sprite->order = 1;
-            leaf05->sprite->pivot = Vector(162.0f, 142.0f, 0.0f);
+            leaf05->sprite->setOrder(1);
+            leaf05->sprite->setPivot(Vector(162.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf05->sprite);
             //  ____
             // | · |
@@ -93,8 +116,8 @@ public:
             //
             leaf06 = addBackground("textures/Leafs.png", 327, 287, Vector2(halfWidth + 50.0f, renderHeight - 120.0f));
             leaf06->sprite->setFrame(5);
-            leaf06->sprite->order = 0;
-            leaf06->sprite->pivot = Vector(0.0f, 142.0f, 0.0f);
+            leaf06->sprite->setOrder(0);
+            leaf06->sprite->setPivot(Vector(0.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf06->sprite);
         }
         // Load sounds.
@@ -158,9 +181,15 @@ public:
         lastGoodTime = lastBadTime = lastBonusTime = TimeManager::getInstance()->getTime();
         // First test for match.
         testForMatch();
+        // Board is shown whole, not image by image.
+        GraphicsManager::getInstance()->waitForTextures();
         created = true;
         return STATUS_OK;
     };
+    // Particles move every step.
+    bool isIdle() {
+        return particleSystem == NULL || particleSystem->isIdle();
+    };
     // Repeat leaf animation.
     void onLeafTweenComplete(Tweenable* leaf) {
         TweenManager::getInstance()->addTween((Sprite*)leaf, TweenType::ROTATION_CW, 1.5f, Ease::Sinusoidal::InOut)
@@ -203,9 +232,9 @@ public:
             "textures/ChilliFruit.png"
         };
         fruit->sprite = spriteBatch->registerSprite(fruitTextures[fruitType], 64, 64);
-        fruit->sprite->location = getSkrewedLocation(x, -1);
-        fruit->sprite->scale = Vector2(0.9f, 0.9f);
-        fruit->sprite->opaque = 0.0f;
+        fruit->sprite->setLocation(getSkrewedLocation(x, -1));
+        fruit->sprite->setScale(Vector2(0.9f, 0.9f));
+        fruit->sprite->setOpaque(0.0f);
         TweenManager::getInstance()->addTween(fruit->sprite, TweenType::OPAQUE, 0.1f, Ease::Sinusoidal::InOut)->target(1.0f)->remove(true)->start();
         fruit->setClickFunction(std::bind(&Gameplay::onFruitClick, this, std::placeholders::_1, std::placeholders::_2));
         fruit->setMoveFunction(std::bind(&Gameplay::onFruitMove, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -566,7 +595,7 @@ public:
                 dyingFruits++;
                 Vector2 location = getSkrewedLocation(x, y);
                 Background* a = addAnimation("textures/ExtraFruitKill.png", 128, 128, location, 17, 0.7f, delay);
-                a->sprite->angle = Deg(frand(360.0f));
+                a->sprite->setAngle(Deg(frand(360.0f)));
                 break;
             }
             default: break;
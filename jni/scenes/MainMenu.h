@@ -17,14 +17,23 @@ public:
         if (created) return STATUS_OK;
         LOG_INFO("Start MainMenu scene.");
         spriteBatch = new SpriteBatch();
+        const char* atlasImages[] = {
+            "textures/Background.png",
+            "textures/GameBox.png",
+            "textures/Leafs.png",
+            "textures/ExitButton.png",
+            "textures/PlayButton.png",
+            "textures/SoundSettingButton.png"
+        };
+        registerAtlasImages(atlasImages);
         float renderWidth = (float)GraphicsManager::getInstance()->getRenderWidth();
         float renderHeight = (float)GraphicsManager::getInstance()->getRenderHeight();
         float halfWidth = renderWidth / 2;
         float halfHeight = renderHeight / 2;
-        background = addBackground("textures/Background.png", 360, 640, Vector2(halfWidth, halfHeight));
+        background = addStaticBackground("textures/Background.png", 360, 640, Vector2(halfWidth, halfHeight));
         gameBox = addBackground("textures/GameBox.png", 360, 380, Vector2(halfWidth, halfHeight));
         gameBox->setClickFunction(std::bind(&MainMenu::onGameBoxClick, this));
-        gameBox->sprite->opaque = 0.0f;
+        gameBox->sprite->setOpaque(0.0f);
         TweenManager::getInstance()->addTween(gameBox->sprite, TweenType::OPAQUE, 0.7f, Ease::Sinusoidal::InOut)
             ->target(1.0f)->remove(true)->start();
         TweenManager::getInstance()->addTween(gameBox->sprite, TweenType::SCALE_X, 0.37f, Ease::Sinusoidal::InOut)
@@ -35,11 +44,11 @@ public:
         if (configData->firstSrtart) {
             // induction logo.
             Background* boom = addBackground("textures/StartScreen.png", 360, 640, Vector2(halfWidth, halfHeight));
-            boom->sprite->order = 10;
+            boom->sprite->setOrder(10);
             TweenManager::getInstance()->addTween(boom->sprite, TweenType::FRAME, 2.3f, Ease::Linear)
                 ->target(43.0f)->remove(true)->start(6.0f);
             Background* induction = addBackground("textures/induction.png", 239, 142, Vector2(halfWidth, halfHeight));
-            induction->sprite->order = 10;
+            induction->sprite->setOrder(10);
             Tween* t1 = TweenManager::getInstance()->addTween(induction->sprite, TweenType::FRAME, 1.25f, Ease::Linear)
                 ->target(30.0f)->remove(true);
             Tween* t2 = TweenManager::getInstance()->addTween(induction->sprite, TweenType::OPAQUE, 0.5f, Ease::Linear)
@@ -69,8 +78,8 @@ public:
             //
             leaf01 = addBackground("textures/Leafs.png", 327, 287, Vector2(renderWidth - 105.0f, 90.0f));
             leaf01->sprite->setFrame(0);
-            leaf01->sprite->order = 1;
-            leaf01->sprite->pivot = Vector(162.0f, -142.0f, 0.0f);
+            leaf01->sprite->setOrder(1);
+            leaf01->sprite->setPivot(Vector(162.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf01->sprite);
             //  ____
             // |   |
@@ -78,8 +87,8 @@ public:
             //
             leaf02 = addBackground("textures/Leafs.png", 327, 287, Vector2(30.0f, 30.0f));
             leaf02->sprite->setFrame(1);
-            leaf02->sprite->order = 1;
-            leaf02->sprite->pivot = Vector(-162.0f, -142.0f, 0.0f);
+            leaf02->sprite->setOrder(1);
+            leaf02->sprite->setPivot(Vector(-162.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf02->sprite);
             //  ____
             // |   |
@@ -87,8 +96,8 @@ public:
             //
             leaf03 = addBackground("textures/Leafs.png", 327, 287, Vector2(halfWidth + 35.0f, 40.0f));
             leaf03->sprite->setFrame(2);
-            leaf03->sprite->order = 0;
-            leaf03->sprite->pivot = Vector(0.0f, -142.0f, 0.0f);
+            leaf03->sprite->setOrder(0);
+            leaf03->sprite->setPivot(Vector(0.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf03->sprite);
             //  ____
             // |·  |
@@ -96,8 +105,8 @@ public:
             //
             leaf04 = addBackground("textures/Leafs.png", 327, 287, Vector2(130.0f, renderHeight - 120.0f));
             leaf04->sprite->setFrame(3);
-            leaf04->sprite->order = 1;
-            leaf04->sprite->pivot = Vector(-162.0f, 142.0f, 0.0f);
+            leaf04->sprite->setOrder(1);
+            leaf04->sprite->setPivot(Vector(-162.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf04->sprite);
             //  ____
             // |  ·|
@@ -105,8 +114,8 @@ public:
             //
             leaf05 = addBackground("textures/Leafs.png", 327, 287, Vector2(renderWidth - 10.0f, renderHeight - 60.0f));
             leaf05->sprite->setFrame(4);
-            leaf05->sprite->order = 1;
-            leaf05->sprite->pivot = Vector(162.0f, 142.0f, 0.0f);
+            leaf05->sprite->setOrder(1);
+            leaf05->sprite->setPivot(Vector(162.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf05->sprite);
             //  ____
             // | · |
@@ -114,8 +123,8 @@ public:
             //
             leaf06 = addBackground("textures/Leafs.png", 327, 287, Vector2(halfWidth + 50.0f, renderHeight - 120.0f));
             leaf06->sprite->setFrame(5);
-            leaf06->sprite->order = 0;
-            leaf06->sprite->pivot = Vector(0.0f, 142.0f, 0.0f);
+            leaf06->sprite->setOrder(0);
+            leaf06->sprite->setPivot(Vector(0.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf06->sprite);
         }
         exitButton = addButton("textures/ExitButton.png", 80, 78, Vector2(halfWidth - 85, halfHeight - 80));
@@ -17,13 +17,23 @@ public:
         if (created) return STATUS_OK;
         LOG_DEBUG("Start SoundSetting scene.");
         spriteBatch = new SpriteBatch();
+        const char* atlasImages[] = {
+            "textures/Background.png",
+            "textures/GameBox.png",
+            "textures/Leafs.png",
+            "textures/SoundPanel.png",
+            "textures/OkButton.png",
+            "textures/SliderBackground.png",
+            "textures/SliderHandle.png"
+        };
+        registerAtlasImages(atlasImages);
         float renderWidth = (float)GraphicsManager::getInstance()->getRenderWidth();
         float renderHeight = (float)GraphicsManager::getInstance()->getRenderHeight();
         float halfWidth = renderWidth / 2;
         float halfHeight = renderHeight / 2;
-        background = addBackground("textures/Background.png", 360, 640, Vector2(halfWidth, halfHeight));
+        background = addStaticBackground("textures/Background.png", 360, 640, Vector2(halfWidth, halfHeight));
         gameBox = addBackground("textures/GameBox.png", 360, 380, Vector2(halfWidth, halfHeight));
-        gameBox->sprite->opaque = 0.0f;
+        gameBox->sprite->setOpaque(0.0f);
         TweenManager::getInstance()->addTween(gameBox->sprite, TweenType::OPAQUE, 0.7f, Ease::Sinusoidal::InOut)
             ->target(1.0f)->remove(true)->start();
         TweenManager::getInstance()->addTween(gameBox->sprite, TweenType::SCALE_X, 0.37f, Ease::Sinusoidal::InOut)
@@ -38,8 +48,8 @@ public:
             //
             leaf01 = addBackground("textures/Leafs.png", 327, 287, Vector2(renderWidth - 105.0f, 90.0f));
             leaf01->sprite->setFrame(0);
-            leaf01->sprite->order = 1;
-            leaf01->sprite->pivot = Vector(162.0f, -142.0f, 0.0f);
+            leaf01->sprite->setOrder(1);
+            leaf01->sprite->setPivot(Vector(162.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf01->sprite);
             //  ____
             // |   |
@@ -47,8 +57,8 @@ public:
             //
             leaf02 = addBackground("textures/Leafs.png", 327, 287, Vector2(30.0f, 30.0f));
             leaf02->sprite->setFrame(1);
-            leaf02->sprite->order = 1;
-            leaf02->sprite->pivot = Vector(-162.0f, -142.0f, 0.0f);
+            leaf02->sprite->setOrder(1);
+            leaf02->sprite->setPivot(Vector(-162.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf02->sprite);
             //  ____
             // |   |
@@ -56,8 +66,8 @@ public:
             //
             leaf03 = addBackground("textures/Leafs.png", 327, 287, Vector2(halfWidth + 35.0f, 40.0f));
             leaf03->sprite->setFrame(2);
-            leaf03->sprite->order = 0;
-            leaf03->sprite->pivot = Vector(0.0f, -142.0f, 0.0f);
+            leaf03->sprite->setOrder(0);
+            leaf03->sprite->setPivot(Vector(0.0f, -142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf03->sprite);
             //  ____
             // |·  |
@@ -65,8 +75,8 @@ public:
             //
             leaf04 = addBackground("textures/Leafs.png", 327, 287, Vector2(130.0f, renderHeight - 120.0f));
             leaf04->sprite->setFrame(3);
-            leaf04->sprite->order = 1;
-            leaf04->sprite->pivot = Vector(-162.0f, 142.0f, 0.0f);
+            leaf04->sprite->setOrder(1);
+            leaf04->sprite->setPivot(Vector(-162.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf04->sprite);
             //  ____
             // |  ·|
@@ -74,8 +84,8 @@ public:
             //
             leaf05 = addBackground("textures/Leafs.png", 327, 287, Vector2(renderWidth - 10.0f, renderHeight - 60.0f));
             leaf05->sprite->setFrame(4);
-            leaf05->sprite->order = 1;
-            leaf05->sprite->pivot = Vector(162.0f, 142.0f, 0.0f);
+            leaf05->sprite->setOrder(1);
+            leaf05->sprite->setPivot(Vector(162.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf05->sprite);
             //  ____
             // | · |
@@ -83,8 +93,8 @@ public:
             //
             leaf06 = addBackground("textures/Leafs.png", 327, 287, Vector2(halfWidth + 50.0f, renderHeight - 120.0f));
             leaf06->sprite->setFrame(5);
-            leaf06->sprite->order = 0;
-            leaf06->sprite->pivot = Vector(0.0f, 142.0f, 0.0f);
+            leaf06->sprite->setOrder(0);
+            leaf06->sprite->setPivot(Vector(0.0f, 142.0f, 0.0f));
             onLeafTweenComplete((Tweenable*)leaf06->sprite);
         }
         sounds = addBackground("textures/SoundPanel.png", 268, 239, Vector2(halfWidth, halfHeight));
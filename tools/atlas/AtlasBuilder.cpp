@@ -0,0 +1,322 @@
+/* Host side atlas builder.
+ *
+ * Packs PNG images of assets/textures into atlas pages and writes the binary
+ * manifest read by GraphicsManager::loadAtlasManifest.
+ *
+ * Usage: AtlasBuilder <assets dir> <sheet list> [page size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <png.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "AtlasPacker.h"
+#include "AtlasManifest.h"
+
+// Texels around each frame, filled with its edge texels so that filtering
+// never samples a neighbour.
+const int ATLAS_PADDING = 2;
+
+struct Frame {
+    // Trimmed rectangle in the source image, top-down.
+    int sourceX, sourceY, width, height;
+    int offsetX, offsetY;
+    // Placement on the page, top-down.
+    int x, y;
+    bool solid;
+};
+
+struct Sheet {
+    std::string name;
+    png_image image;
+    std::vector<unsigned char> pixels;
+    int frameWidth, frameHeight;
+    int pivotX, pivotY;
+    std::vector<Frame> frames;
+    int page;
+    uint32_t firstFrame;
+};
+
+struct SheetInfo {
+    std::string name;
+    int frameWidth, frameHeight;
+    int pivotX, pivotY;
+};
+
+// Reads "<path> <frame width> <frame height> [<pivot x> <pivot y>]" lines.
+static std::vector<SheetInfo> readSheetList(const char* path) {
+    std::vector<SheetInfo> list;
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Can not open sheet list %s\n", path);
+        return list;
+    }
+    char line[256], name[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#') continue;
+        SheetInfo info = { "", 0, 0, 0, 0 };
+        if (sscanf(line, "%255s %d %d %d %d", name, &info.frameWidth, &info.frameHeight, &info.pivotX, &info.pivotY) < 3) continue;
+        info.name = name;
+        list.push_back(info);
+    }
+    fclose(file);
+    return list;
+}
+
+static bool loadSheet(const std::string& assets, Sheet& sheet) {
+    std::string path = assets + "/" + sheet.name;
+    memset(&sheet.image, 0, sizeof(sheet.image));
+    sheet.image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&sheet.image, path.c_str())) {
+        fprintf(stderr, "Can not read %s: %s\n", path.c_str(), sheet.image.message);
+        return false;
+    }
+    sheet.image.format = PNG_FORMAT_RGBA;
+    sheet.pixels.resize(PNG_IMAGE_SIZE(sheet.image));
+    if (!png_image_finish_read(&sheet.image, NULL, &sheet.pixels[0], 0, NULL)) {
+        fprintf(stderr, "Can not decode %s: %s\n", path.c_str(), sheet.image.message);
+        return false;
+    }
+    return true;
+}
+
+// Cuts the sheet by frame grid and trims transparent borders.
+static void trimFrames(Sheet& sheet) {
+    int width = sheet.image.width, height = sheet.image.height;
+    if (sheet.frameWidth <= 0 || sheet.frameWidth > width) sheet.frameWidth = width;
+    if (sheet.frameHeight <= 0 || sheet.frameHeight > height) sheet.frameHeight = height;
+    int columns = width / sheet.frameWidth, rows = height / sheet.frameHeight;
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            int left = sheet.frameWidth, top = sheet.frameHeight, right = -1, bottom = -1;
+            for (int y = 0; y < sheet.frameHeight; ++y) {
+                const unsigned char* pixel = &sheet.pixels[((row * sheet.frameHeight + y) * width + column * sheet.frameWidth) * 4];
+                for (int x = 0; x < sheet.frameWidth; ++x, pixel += 4) {
+                    if (pixel[3] == 0) continue;
+                    left = std::min(left, x);
+                    right = std::max(right, x);
+                    top = std::min(top, y);
+                    bottom = std::max(bottom, y);
+                }
+            }
+            Frame frame = { 0, 0, 0, 0, 0, 0, 0, 0, false };
+            if (right >= 0) {
+                frame.sourceX = column * sheet.frameWidth + left;
+                frame.sourceY = row * sheet.frameHeight + top;
+                frame.width = right - left + 1;
+                frame.height = bottom - top + 1;
+                frame.offsetX = left;
+                frame.offsetY = top;
+                // Solid frames are drawn without blending.
+                frame.solid = true;
+                for (int y = 0; y < frame.height && frame.solid; ++y) {
+                    const unsigned char* pixel = &sheet.pixels[((frame.sourceY + y) * width + frame.sourceX) * 4];
+                    for (int x = 0; x < frame.width; ++x, pixel += 4) {
+                        if (pixel[3] != 0xFF) {
+                            frame.solid = false;
+                            break;
+                        }
+                    }
+                }
+            }
+            sheet.frames.push_back(frame);
+        }
+    }
+}
+
+// Places all frames of the sheet, leaves packer untouched if it fails.
+static bool placeSheet(AtlasPacker& packer, Sheet& sheet) {
+    AtlasPacker trial = packer;
+    std::vector<int> order(sheet.frames.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+    struct Higher {
+        const std::vector<Frame>& frames;
+        bool operator()(int a, int b) const { return frames[a].height > frames[b].height; }
+    } higher = { sheet.frames };
+    std::stable_sort(order.begin(), order.end(), higher);
+    for (size_t i = 0; i < order.size(); ++i) {
+        Frame& frame = sheet.frames[order[i]];
+        if (frame.width == 0) continue;
+        if (!trial.insert(frame.width + 2 * ATLAS_PADDING, frame.height + 2 * ATLAS_PADDING, frame.x, frame.y)) return false;
+        frame.x += ATLAS_PADDING;
+        frame.y += ATLAS_PADDING;
+    }
+    packer = trial;
+    return true;
+}
+
+static int sheetHeight(const Sheet& sheet) {
+    int height = 0;
+    for (size_t i = 0; i < sheet.frames.size(); ++i) height = std::max(height, sheet.frames[i].height);
+    return height;
+}
+
+static bool compareSheetHeight(const Sheet* a, const Sheet* b) {
+    return sheetHeight(*a) > sheetHeight(*b);
+}
+
+static bool compareSheetHash(const Sheet* a, const Sheet* b) {
+    return atlasNameHash(a->name.c_str()) < atlasNameHash(b->name.c_str());
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <assets dir> <sheet list> [page size]\n", argv[0]);
+        return 1;
+    }
+    std::string assets = argv[1];
+    int pageSize = (argc > 3) ? atoi(argv[3]) : 1024;
+    std::vector<SheetInfo> sheetList = readSheetList(argv[2]);
+    // Collects all texture images.
+    std::vector<std::string> names;
+    DIR* directory = opendir((assets + "/textures").c_str());
+    if (directory == NULL) {
+        fprintf(stderr, "Can not open %s/textures\n", assets.c_str());
+        return 1;
+    }
+    while (struct dirent* entry = readdir(directory)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".png") == 0) names.push_back("textures/" + name);
+    }
+    closedir(directory);
+    std::sort(names.begin(), names.end());
+    std::vector<Sheet> sheets(names.size());
+    std::vector<Sheet*> packed;
+    for (size_t i = 0; i < names.size(); ++i) {
+        Sheet& sheet = sheets[i];
+        sheet.name = names[i];
+        sheet.frameWidth = sheet.frameHeight = 0;
+        sheet.pivotX = sheet.pivotY = 0;
+        sheet.page = -1;
+        for (size_t n = 0; n < sheetList.size(); ++n) {
+            if (sheetList[n].name != sheet.name) continue;
+            sheet.frameWidth = sheetList[n].frameWidth;
+            sheet.frameHeight = sheetList[n].frameHeight;
+            sheet.pivotX = sheetList[n].pivotX;
+            sheet.pivotY = sheetList[n].pivotY;
+        }
+        if (sheet.name.size() >= (size_t)ATLAS_PATH_SIZE || !loadSheet(assets, sheet)) continue;
+        trimFrames(sheet);
+        packed.push_back(&sheet);
+    }
+    // Packs highest sheets first, all frames of a sheet share the page.
+    std::stable_sort(packed.begin(), packed.end(), compareSheetHeight);
+    std::vector<AtlasPacker> packers;
+    for (std::vector<Sheet*>::iterator it = packed.begin(); it < packed.end();) {
+        Sheet& sheet = **it;
+        for (size_t page = 0; page < packers.size() && sheet.page < 0; ++page) {
+            if (placeSheet(packers[page], sheet)) sheet.page = (int)page;
+        }
+        if (sheet.page < 0) {
+            AtlasPacker packer(pageSize, pageSize);
+            if (placeSheet(packer, sheet)) {
+                sheet.page = (int)packers.size();
+                packers.push_back(packer);
+            }
+        }
+        if (sheet.page < 0) {
+            printf("%s does not fit the page, left standalone.\n", sheet.name.c_str());
+            it = packed.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    // Renders pages.
+    std::vector<AtlasPage> pages(packers.size());
+    for (size_t page = 0; page < packers.size(); ++page) {
+        std::vector<unsigned char> pixels(pageSize * pageSize * 4, 0);
+        for (std::vector<Sheet*>::iterator it = packed.begin(); it < packed.end(); ++it) {
+            Sheet& sheet = **it;
+            if (sheet.page != (int)page) continue;
+            for (size_t i = 0; i < sheet.frames.size(); ++i) {
+                Frame& frame = sheet.frames[i];
+                if (frame.width == 0) continue;
+                for (int y = -ATLAS_PADDING; y < frame.height + ATLAS_PADDING; ++y) {
+                    int sourceY = frame.sourceY + std::min(std::max(y, 0), frame.height - 1);
+                    for (int x = -ATLAS_PADDING; x < frame.width + ATLAS_PADDING; ++x) {
+                        int sourceX = frame.sourceX + std::min(std::max(x, 0), frame.width - 1);
+                        memcpy(&pixels[((frame.y + y) * pageSize + frame.x + x) * 4],
+                            &sheet.pixels[(sourceY * sheet.image.width + sourceX) * 4], 4);
+                    }
+                }
+            }
+        }
+        memset(&pages[page], 0, sizeof(AtlasPage));
+        snprintf(pages[page].path, ATLAS_PATH_SIZE, "atlas/page%d.png", (int)page);
+        pages[page].width = pageSize;
+        pages[page].height = pageSize;
+        png_image image;
+        memset(&image, 0, sizeof(image));
+        image.version = PNG_IMAGE_VERSION;
+        image.width = pageSize;
+        image.height = pageSize;
+        image.format = PNG_FORMAT_RGBA;
+        std::string path = assets + "/" + pages[page].path;
+        if (!png_image_write_to_file(&image, path.c_str(), 0, &pixels[0], 0, NULL)) {
+            fprintf(stderr, "Can not write %s: %s\n", path.c_str(), image.message);
+            return 1;
+        }
+    }
+    // Sheets are looked up by binary search of the name hash.
+    std::stable_sort(packed.begin(), packed.end(), compareSheetHash);
+    std::vector<AtlasSheet> sheetRecords;
+    std::vector<AtlasFrame> frameRecords;
+    for (std::vector<Sheet*>::iterator it = packed.begin(); it < packed.end(); ++it) {
+        Sheet& sheet = **it;
+        AtlasSheet record;
+        memset(&record, 0, sizeof(record));
+        record.nameHash = atlasNameHash(sheet.name.c_str());
+        // Sheets sharing a hash stay next to each other, the lookup
+        // compares their names.
+        if (!sheetRecords.empty() && sheetRecords.back().nameHash == record.nameHash) {
+            printf("Name hash collision: %s and %s\n", sheetRecords.back().name, sheet.name.c_str());
+        }
+        record.page = sheet.page;
+        record.frameCount = sheet.frames.size();
+        record.firstFrame = frameRecords.size();
+        strncpy(record.name, sheet.name.c_str(), ATLAS_PATH_SIZE - 1);
+        sheetRecords.push_back(record);
+        for (size_t i = 0; i < sheet.frames.size(); ++i) {
+            Frame& frame = sheet.frames[i];
+            // Converts to bottom-up coordinates of the uploaded texture.
+            AtlasFrame atlasFrame;
+            atlasFrame.x = frame.x;
+            atlasFrame.y = (frame.width == 0) ? 0 : pageSize - frame.y - frame.height;
+            atlasFrame.width = frame.width;
+            atlasFrame.height = frame.height;
+            atlasFrame.offsetX = frame.offsetX;
+            atlasFrame.offsetY = (frame.width == 0) ? 0 : sheet.frameHeight - frame.offsetY - frame.height;
+            atlasFrame.sourceWidth = sheet.frameWidth;
+            atlasFrame.sourceHeight = sheet.frameHeight;
+            atlasFrame.pivotX = sheet.pivotX;
+            atlasFrame.pivotY = sheet.pivotY;
+            atlasFrame.flags = frame.solid ? ATLAS_FRAME_SOLID : 0;
+            frameRecords.push_back(atlasFrame);
+        }
+    }
+    AtlasManifestHeader header;
+    header.magic = ATLAS_MANIFEST_MAGIC;
+    header.version = ATLAS_MANIFEST_VERSION;
+    header.pageCount = pages.size();
+    header.sheetCount = sheetRecords.size();
+    header.frameCount = frameRecords.size();
+    std::string path = assets + "/atlas/atlas.bin";
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Can not write %s\n", path.c_str());
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    if (!pages.empty()) fwrite(&pages[0], sizeof(AtlasPage), pages.size(), file);
+    if (!sheetRecords.empty()) fwrite(&sheetRecords[0], sizeof(AtlasSheet), sheetRecords.size(), file);
+    if (!frameRecords.empty()) fwrite(&frameRecords[0], sizeof(AtlasFrame), frameRecords.size(), file);
+    fclose(file);
+    printf("Packed %d sheets, %d frames into %d pages.\n", (int)sheetRecords.size(), (int)frameRecords.size(), (int)pages.size());
+    return 0;
+}
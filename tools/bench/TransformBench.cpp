@@ -0,0 +1,112 @@
+/* Sprite corner transform microbenchmark.
+ *
+ * Compares the 4x4 Matrix path with Transform2D and the batched
+ * TransformQuads kernel (NEON, SSE or scalar, as compiled).
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <vector>
+
+#define LOG_DEBUG(...) printf(__VA_ARGS__)
+#include "Geometry.h"
+
+const int SPRITE_COUNT = 1000;
+const int ITERATIONS = 2000;
+
+struct SpriteState {
+    Vector2 location, scale;
+    float angle;
+    Vector pivot;
+    Rect quad;
+};
+
+static double now() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static void matrixPath(const std::vector<SpriteState>& sprites, float* corners) {
+    for (size_t i = 0; i < sprites.size(); ++i, corners += 8) {
+        const SpriteState& s = sprites[i];
+        Matrix matrix = IdentityMatrix;
+        matrix.Translate(s.location.x, s.location.y, 0.0f);
+        matrix.Translate(s.pivot.x, s.pivot.y, 0.0f);
+        matrix.Rotate(s.angle, AxisZ);
+        matrix.Translate(-s.pivot.x, -s.pivot.y, 0.0f);
+        matrix.Scale(s.scale.x, s.scale.y, 1.0f);
+        Vector points[4] = {
+            matrix * Vector(s.quad.left, s.quad.bottom, 0.0f),
+            matrix * Vector(s.quad.left, s.quad.top, 0.0f),
+            matrix * Vector(s.quad.right, s.quad.bottom, 0.0f),
+            matrix * Vector(s.quad.right, s.quad.top, 0.0f)
+        };
+        for (int n = 0; n < 4; ++n) {
+            corners[n * 2] = points[n].x;
+            corners[n * 2 + 1] = points[n].y;
+        }
+    }
+}
+
+static void batchPath(const std::vector<SpriteState>& sprites, std::vector<Transform2D>& transforms,
+        std::vector<Rect>& quads, float* corners) {
+    for (size_t i = 0; i < sprites.size(); ++i) {
+        const SpriteState& s = sprites[i];
+        transforms[i].Set(s.location, s.scale, s.angle, s.pivot);
+        quads[i] = s.quad;
+    }
+    TransformQuads(&transforms[0], &quads[0], corners, sprites.size());
+}
+
+int main() {
+    std::vector<SpriteState> sprites(SPRITE_COUNT);
+    for (int i = 0; i < SPRITE_COUNT; ++i) {
+        SpriteState& s = sprites[i];
+        s.location = Vector2(frand(360.0f), frand(640.0f));
+        s.scale = Vector2(frandRange(0.5f, 1.5f), frandRange(0.5f, 1.5f));
+        s.angle = frand(360.0f);
+        s.pivot = Vector(frandRange(-50.0f, 50.0f), frandRange(-50.0f, 50.0f), 0.0f);
+        s.quad = Rect(-32.0f, 32.0f, 32.0f, -32.0f);
+    }
+    std::vector<float> expected(SPRITE_COUNT * 8), corners(SPRITE_COUNT * 8);
+    std::vector<Transform2D> transforms(SPRITE_COUNT);
+    std::vector<Rect> quads(SPRITE_COUNT);
+    // Checks both paths agree.
+    matrixPath(sprites, &expected[0]);
+    batchPath(sprites, transforms, quads, &corners[0]);
+    float maxError = 0.0f;
+    for (size_t i = 0; i < corners.size(); ++i) maxError = MAX(maxError, fabsf(corners[i] - expected[i]));
+    printf("Max difference: %g\n", maxError);
+    // Angle changes every iteration, so sine and cosine are not cached.
+    double start = now();
+    for (int n = 0; n < ITERATIONS; ++n) {
+        sprites[n % SPRITE_COUNT].angle += 1.0f;
+        matrixPath(sprites, &expected[0]);
+    }
+    double matrixTime = now() - start;
+    start = now();
+    for (int n = 0; n < ITERATIONS; ++n) {
+        for (int i = 0; i < SPRITE_COUNT; ++i) sprites[i].angle += 1.0f;
+        batchPath(sprites, transforms, quads, &corners[0]);
+    }
+    double batchTime = now() - start;
+    start = now();
+    for (int n = 0; n < ITERATIONS; ++n) {
+        TransformQuads(&transforms[0], &quads[0], &corners[0], SPRITE_COUNT);
+    }
+    double kernelTime = now() - start;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    const char* kernel = "NEON";
+#elif defined(__SSE__)
+    const char* kernel = "SSE";
+#else
+    const char* kernel = "scalar";
+#endif
+    double scale = 1e9 / ((double)ITERATIONS * SPRITE_COUNT);
+    printf("Matrix path     : %6.1f ns/sprite\n", matrixTime * scale);
+    printf("Transform2D path: %6.1f ns/sprite (%s kernel)\n", batchTime * scale, kernel);
+    printf("Kernel only     : %6.1f ns/sprite\n", kernelTime * scale);
+    return (maxError < 1e-3f) ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/* Host side flipbook builder.
+ *
+ * Cuts a sprite sheet PNG into frames and writes each one as a PNG image of
+ * the flipbook streamed by Flipbook in place of the sheet.
+ *
+ * Usage: FlipbookBuilder <sheet.png> <frame width> <frame height> <sheet.flb>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+
+#include <vector>
+
+#include "FlipbookFormat.h"
+
+// Encodes the frame at column, row of the sheet.
+static bool encodeFrame(const png_image& sheet, const std::vector<unsigned char>& pixels, int column, int row,
+        int frameWidth, int frameHeight, bool solid, std::vector<unsigned char>& output) {
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    image.width = frameWidth;
+    image.height = frameHeight;
+    image.format = solid ? PNG_FORMAT_RGB : PNG_FORMAT_RGBA;
+    int channels = solid ? 3 : 4;
+    // Frame pixels in the format written, top-down.
+    std::vector<unsigned char> frame(frameWidth * frameHeight * channels);
+    for (int y = 0; y < frameHeight; ++y) {
+        const unsigned char* source = &pixels[((row * frameHeight + y) * sheet.width + column * frameWidth) * 4];
+        unsigned char* destination = &frame[y * frameWidth * channels];
+        for (int x = 0; x < frameWidth; ++x, source += 4, destination += channels) {
+            memcpy(destination, source, channels);
+        }
+    }
+    png_alloc_size_t size = 0;
+    if (!png_image_write_to_memory(&image, NULL, &size, 0, &frame[0], 0, NULL)) return false;
+    output.resize(size);
+    return png_image_write_to_memory(&image, &output[0], &size, 0, &frame[0], 0, NULL) != 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <sheet.png> <frame width> <frame height> <sheet.flb>\n", argv[0]);
+        return 1;
+    }
+    int frameWidth = atoi(argv[2]), frameHeight = atoi(argv[3]);
+    png_image sheet;
+    memset(&sheet, 0, sizeof(sheet));
+    sheet.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&sheet, argv[1])) {
+        fprintf(stderr, "Can not read %s: %s\n", argv[1], sheet.message);
+        return 1;
+    }
+    sheet.format = PNG_FORMAT_RGBA;
+    std::vector<unsigned char> pixels(PNG_IMAGE_SIZE(sheet));
+    if (!png_image_finish_read(&sheet, NULL, &pixels[0], 0, NULL)) {
+        fprintf(stderr, "Can not decode %s: %s\n", argv[1], sheet.message);
+        return 1;
+    }
+    if (frameWidth <= 0 || frameWidth > (int)sheet.width || frameHeight <= 0 || frameHeight > (int)sheet.height) {
+        fprintf(stderr, "Frame size does not fit %s\n", argv[1]);
+        return 1;
+    }
+    bool solid = true;
+    for (size_t i = 3; i < pixels.size() && solid; i += 4) solid = (pixels[i] == 0xFF);
+    // Frames are numbered the way sprites number sheet frames.
+    int columns = sheet.width / frameWidth, rows = sheet.height / frameHeight;
+    FlipbookHeader header;
+    header.magic = FLIPBOOK_MAGIC;
+    header.version = FLIPBOOK_VERSION;
+    header.frameCount = columns * rows;
+    header.frameWidth = frameWidth;
+    header.frameHeight = frameHeight;
+    header.flags = solid ? FLIPBOOK_SOLID : 0;
+    std::vector<uint32_t> offsets(header.frameCount + 1);
+    std::vector<unsigned char> data;
+    offsets[0] = sizeof(header) + offsets.size() * sizeof(uint32_t);
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            std::vector<unsigned char> frame;
+            if (!encodeFrame(sheet, pixels, column, row, frameWidth, frameHeight, solid, frame)) {
+                fprintf(stderr, "Can not encode frame %d of %s\n", row * columns + column, argv[1]);
+                return 1;
+            }
+            data.insert(data.end(), frame.begin(), frame.end());
+            offsets[row * columns + column + 1] = offsets[0] + data.size();
+        }
+    }
+    FILE* file = fopen(argv[4], "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Can not write %s\n", argv[4]);
+        return 1;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(&offsets[0], sizeof(uint32_t), offsets.size(), file) == offsets.size()
+        && fwrite(&data[0], data.size(), 1, file) == 1;
+    fclose(file);
+    if (!written) {
+        fprintf(stderr, "Can not write %s\n", argv[4]);
+        return 1;
+    }
+    printf("%s: %d frames of %d x %d, %d bytes\n", argv[4], header.frameCount, frameWidth, frameHeight, offsets.back());
+    return 0;
+}
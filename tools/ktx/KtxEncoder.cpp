@@ -0,0 +1,285 @@
+/* Host side texture compressor.
+ *
+ * Encodes a PNG image into the KTX file loaded by Texture::loadFromFile in
+ * place of the image. Opaque images are encoded as ETC1, others as ETC2 RGBA8
+ * (ETC1 compatible color blocks and EAC alpha blocks).
+ *
+ * Usage: KtxEncoder <image.png> <image.ktx>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "KtxFormat.h"
+
+#define GL_RGB  0x1907
+#define GL_RGBA 0x1908
+
+// Modifiers of ETC1 subblocks, by table.
+static const int ETC_MODIFIERS[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// Modifiers of EAC blocks, by table.
+static const int EAC_MODIFIERS[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+static int clampByte(int value) {
+    return std::min(255, std::max(0, value));
+}
+
+// Subblock pixels are given as indices into the block, x * 4 + y.
+struct Subblock {
+    int pixels[8];
+    // Chosen table and pixel modifier indices.
+    int table;
+    int indices[8];
+    long error;
+};
+
+// Picks the table and modifiers of a subblock for its base color.
+static void fitSubblock(const unsigned char* block, Subblock& subblock, const int* base) {
+    subblock.error = -1;
+    for (int table = 0; table < 8; ++table) {
+        int modifiers[4] = { ETC_MODIFIERS[table][0], ETC_MODIFIERS[table][1], -ETC_MODIFIERS[table][0], -ETC_MODIFIERS[table][1] };
+        long error = 0;
+        int indices[8];
+        for (int i = 0; i < 8; ++i) {
+            const unsigned char* pixel = &block[subblock.pixels[i] * 4];
+            long best = -1;
+            for (int m = 0; m < 4; ++m) {
+                long pixelError = 0;
+                for (int c = 0; c < 3; ++c) {
+                    int delta = clampByte(base[c] + modifiers[m]) - pixel[c];
+                    pixelError += delta * delta;
+                }
+                if (best < 0 || pixelError < best) {
+                    best = pixelError;
+                    indices[i] = m;
+                }
+            }
+            // Colors of transparent pixels are not seen.
+            error += best * (pixel[3] + 1);
+        }
+        if (subblock.error < 0 || error < subblock.error) {
+            subblock.error = error;
+            subblock.table = table;
+            memcpy(subblock.indices, indices, sizeof(indices));
+        }
+    }
+}
+
+// Average weighted by alpha, the most visible pixels count the most.
+static void averageColor(const unsigned char* block, const Subblock& subblock, int* average) {
+    for (int c = 0; c < 3; ++c) {
+        long sum = 0, weights = 0;
+        for (int i = 0; i < 8; ++i) {
+            const unsigned char* pixel = &block[subblock.pixels[i] * 4];
+            sum += pixel[c] * (pixel[3] + 1);
+            weights += pixel[3] + 1;
+        }
+        average[c] = (sum + weights / 2) / weights;
+    }
+}
+
+static void writeBigEndian(unsigned char* output, uint64_t value, int size) {
+    for (int i = size - 1; i >= 0; --i, value >>= 8) output[i] = value & 0xFF;
+}
+
+// Encodes 4x4 RGBA pixels, stored x * 4 + y, into an ETC1 block. Blocks use
+// no differential overflow, so ETC2 decoders read them the same way.
+static void encodeColorBlock(const unsigned char* block, unsigned char* output) {
+    uint64_t best = 0;
+    long bestError = -1;
+    for (int flip = 0; flip < 2; ++flip) {
+        // Halves are left and right, or top and bottom when flipped.
+        Subblock subblocks[2];
+        int counts[2] = { 0, 0 };
+        for (int x = 0; x < 4; ++x) {
+            for (int y = 0; y < 4; ++y) {
+                int half = flip ? (y >= 2) : (x >= 2);
+                subblocks[half].pixels[counts[half]++] = x * 4 + y;
+            }
+        }
+        int averages[2][3];
+        averageColor(block, subblocks[0], averages[0]);
+        averageColor(block, subblocks[1], averages[1]);
+        for (int differential = 0; differential < 2; ++differential) {
+            int quantized[2][3], bases[2][3];
+            bool valid = true;
+            for (int c = 0; c < 3; ++c) {
+                for (int half = 0; half < 2; ++half) {
+                    if (differential) {
+                        quantized[half][c] = (averages[half][c] * 31 + 127) / 255;
+                        bases[half][c] = (quantized[half][c] << 3) | (quantized[half][c] >> 2);
+                    } else {
+                        quantized[half][c] = (averages[half][c] * 15 + 127) / 255;
+                        bases[half][c] = (quantized[half][c] << 4) | quantized[half][c];
+                    }
+                }
+                int delta = quantized[1][c] - quantized[0][c];
+                if (differential && (delta < -4 || delta > 3)) valid = false;
+            }
+            if (!valid) continue;
+            fitSubblock(block, subblocks[0], bases[0]);
+            fitSubblock(block, subblocks[1], bases[1]);
+            long error = subblocks[0].error + subblocks[1].error;
+            if (bestError >= 0 && error >= bestError) continue;
+            bestError = error;
+            uint64_t bits = 0;
+            for (int c = 0; c < 3; ++c) {
+                uint64_t channel = differential
+                    ? (quantized[0][c] << 3) | ((quantized[1][c] - quantized[0][c]) & 7)
+                    : (quantized[0][c] << 4) | quantized[1][c];
+                bits |= channel << (56 - c * 8);
+            }
+            bits |= (uint64_t)subblocks[0].table << 37;
+            bits |= (uint64_t)subblocks[1].table << 34;
+            bits |= (uint64_t)differential << 33;
+            bits |= (uint64_t)flip << 32;
+            // Modifier index 0..3 is +small, +large, -small, -large, stored
+            // as most and least significant bit planes.
+            for (int half = 0; half < 2; ++half) {
+                for (int i = 0; i < 8; ++i) {
+                    int pixel = subblocks[half].pixels[i];
+                    int index = subblocks[half].indices[i];
+                    bits |= (uint64_t)(index >> 1) << (16 + pixel);
+                    bits |= (uint64_t)(index & 1) << pixel;
+                }
+            }
+            best = bits;
+        }
+    }
+    writeBigEndian(output, best, 8);
+}
+
+// Encodes the alpha of 4x4 RGBA pixels, stored x * 4 + y, into an EAC block.
+static void encodeAlphaBlock(const unsigned char* block, unsigned char* output) {
+    int minimum = 255, maximum = 0;
+    for (int i = 0; i < 16; ++i) {
+        minimum = std::min(minimum, (int)block[i * 4 + 3]);
+        maximum = std::max(maximum, (int)block[i * 4 + 3]);
+    }
+    uint64_t best = 0;
+    long bestError = -1;
+    for (int table = 0; table < 16; ++table) {
+        const int* modifiers = EAC_MODIFIERS[table];
+        int low = modifiers[3], high = modifiers[7];
+        // Multipliers spreading the table over the alpha range.
+        int multiplier = (maximum - minimum + (high - low) / 2) / (high - low);
+        for (int m = std::max(1, multiplier - 1); m <= std::min(15, multiplier + 1); ++m) {
+            int center = (minimum + maximum) / 2 - m * (low + high) / 2;
+            for (int base = clampByte(center - 1); base <= clampByte(center + 1); ++base) {
+                long error = 0;
+                uint64_t indices = 0;
+                for (int i = 0; i < 16; ++i) {
+                    int alpha = block[i * 4 + 3];
+                    long pixelBest = -1;
+                    int pixelIndex = 0;
+                    for (int index = 0; index < 8; ++index) {
+                        int delta = clampByte(base + modifiers[index] * m) - alpha;
+                        if (pixelBest < 0 || delta * delta < pixelBest) {
+                            pixelBest = delta * delta;
+                            pixelIndex = index;
+                        }
+                    }
+                    error += pixelBest;
+                    indices |= (uint64_t)pixelIndex << (45 - i * 3);
+                }
+                if (bestError >= 0 && error >= bestError) continue;
+                bestError = error;
+                best = ((uint64_t)base << 56) | ((uint64_t)m << 52) | ((uint64_t)table << 48) | indices;
+            }
+        }
+    }
+    writeBigEndian(output, best, 8);
+}
+
+static bool writeKtx(const char* path, uint32_t internalFormat, uint32_t baseFormat,
+        int width, int height, const std::vector<unsigned char>& data) {
+    KtxHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = KTX_ENDIANNESS;
+    header.glTypeSize = 1;
+    header.glInternalFormat = internalFormat;
+    header.glBaseInternalFormat = baseFormat;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = 1;
+    uint32_t imageSize = data.size();
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Can not write %s\n", path);
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(&imageSize, sizeof(imageSize), 1, file) == 1
+        && fwrite(&data[0], data.size(), 1, file) == 1;
+    fclose(file);
+    if (!written) fprintf(stderr, "Can not write %s\n", path);
+    return written;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <image.png> <image.ktx>\n", argv[0]);
+        return 1;
+    }
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, argv[1])) {
+        fprintf(stderr, "Can not read %s: %s\n", argv[1], image.message);
+        return 1;
+    }
+    image.format = PNG_FORMAT_RGBA;
+    std::vector<unsigned char> pixels(PNG_IMAGE_SIZE(image));
+    // Negative stride reads rows bottom-up, as textures are uploaded.
+    if (!png_image_finish_read(&image, NULL, &pixels[0], -(png_int_32)PNG_IMAGE_ROW_STRIDE(image), NULL)) {
+        fprintf(stderr, "Can not decode %s: %s\n", argv[1], image.message);
+        return 1;
+    }
+    int width = image.width, height = image.height;
+    bool opaque = true;
+    for (size_t i = 3; i < pixels.size() && opaque; i += 4) opaque = (pixels[i] == 0xFF);
+    uint32_t internalFormat = opaque ? GL_ETC1_RGB8_OES : GL_COMPRESSED_RGBA8_ETC2_EAC;
+    std::vector<unsigned char> data(ktxImageSize(internalFormat, width, height));
+    unsigned char* output = &data[0];
+    unsigned char block[16 * 4];
+    for (int blockY = 0; blockY < height; blockY += 4) {
+        for (int blockX = 0; blockX < width; blockX += 4) {
+            // Edge blocks repeat the last column and row.
+            for (int x = 0; x < 4; ++x) {
+                for (int y = 0; y < 4; ++y) {
+                    int sourceX = std::min(blockX + x, width - 1), sourceY = std::min(blockY + y, height - 1);
+                    memcpy(&block[(x * 4 + y) * 4], &pixels[(sourceY * width + sourceX) * 4], 4);
+                }
+            }
+            if (!opaque) {
+                encodeAlphaBlock(block, output);
+                output += 8;
+            }
+            encodeColorBlock(block, output);
+            output += 8;
+        }
+    }
+    if (!writeKtx(argv[2], internalFormat, opaque ? GL_RGB : GL_RGBA, width, height, data)) return 1;
+    printf("%s: %d x %d %s, %d bytes instead of %d\n", argv[2], width, height, opaque ? "ETC1" : "ETC2 RGBA8",
+        (int)data.size(), width * height * 4);
+    return 0;
+}
@@ -0,0 +1,178 @@
+/* Surface damage test.
+ *
+ * Runs SurfaceDamage against fake EGL functions and checks the region
+ * given to eglSetDamageRegionKHR for each age of the back buffer, and
+ * the damage given to the swap with damage extensions.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#define LOG_INFO(...) printf(__VA_ARGS__), printf("\n")
+#define LOG_ERROR(...) printf(__VA_ARGS__), printf("\n")
+#include "SurfaceDamage.h"
+
+const int SURFACE_WIDTH = 100;
+const int SURFACE_HEIGHT = 200;
+
+// State of the fake display.
+static const char* extensions = "";
+static EGLint bufferAge = 0;
+static bool queryFails = false;
+static int regionCount = 0;
+static EGLint region[4];
+static int swapCount = 0;
+static int khrSwapCount = 0;
+static int extSwapCount = 0;
+static EGLint swapDamage[4];
+static EGLint swapDamageCount = 0;
+static int failures = 0;
+
+static const char* EGLAPIENTRY fakeQueryString(EGLDisplay, EGLint) {
+    return extensions;
+}
+
+static EGLBoolean EGLAPIENTRY fakeSetDamageRegion(EGLDisplay, EGLSurface, EGLint* rects, EGLint count) {
+    ++regionCount;
+    if (count == 1) memcpy(region, rects, sizeof(region));
+    return EGL_TRUE;
+}
+
+static void recordSwapDamage(const EGLint* rects, EGLint count) {
+    swapDamageCount = count;
+    if (count == 1) memcpy(swapDamage, rects, sizeof(swapDamage));
+}
+
+static EGLBoolean EGLAPIENTRY fakeSwapBuffersWithDamageKHR(EGLDisplay, EGLSurface, const EGLint* rects, EGLint count) {
+    ++khrSwapCount;
+    recordSwapDamage(rects, count);
+    return EGL_TRUE;
+}
+
+static EGLBoolean EGLAPIENTRY fakeSwapBuffersWithDamageEXT(EGLDisplay, EGLSurface, const EGLint* rects, EGLint count) {
+    ++extSwapCount;
+    recordSwapDamage(rects, count);
+    return EGL_TRUE;
+}
+
+static __eglMustCastToProperFunctionPointerType EGLAPIENTRY fakeGetProcAddress(const char* name) {
+    if (strcmp(name, "eglSetDamageRegionKHR") == 0) return (__eglMustCastToProperFunctionPointerType) fakeSetDamageRegion;
+    if (strcmp(name, "eglSwapBuffersWithDamageKHR") == 0) return (__eglMustCastToProperFunctionPointerType) fakeSwapBuffersWithDamageKHR;
+    if (strcmp(name, "eglSwapBuffersWithDamageEXT") == 0) return (__eglMustCastToProperFunctionPointerType) fakeSwapBuffersWithDamageEXT;
+    return NULL;
+}
+
+static EGLBoolean EGLAPIENTRY fakeQuerySurface(EGLDisplay, EGLSurface, EGLint attribute, EGLint* value) {
+    if (queryFails || attribute != EGL_BUFFER_AGE_KHR) return EGL_FALSE;
+    *value = bufferAge;
+    return EGL_TRUE;
+}
+
+static EGLBoolean EGLAPIENTRY fakeSwapBuffers(EGLDisplay, EGLSurface) {
+    ++swapCount;
+    return EGL_TRUE;
+}
+
+static EGLint EGLAPIENTRY fakeGetError() {
+    return EGL_SUCCESS;
+}
+
+const SurfaceDamageEGL FAKE_EGL = {
+    fakeQueryString, fakeGetProcAddress, fakeQuerySurface, fakeSwapBuffers, fakeGetError
+};
+
+static void check(const char* name, bool passed) {
+    if (!passed) ++failures;
+    printf("%s %s\n", passed ? "ok  " : "FAIL", name);
+}
+
+static bool isRegion(const EGLint* rect, EGLint x, EGLint y, EGLint width, EGLint height) {
+    return rect[0] == x && rect[1] == y && rect[2] == width && rect[3] == height;
+}
+
+// Begins a frame with the damage and the age of the back buffer, the
+// region to redraw is returned.
+static void frame(SurfaceDamage& surfaceDamage, EGLint x, EGLint y, EGLint width, EGLint height,
+        EGLint age, EGLint* redraw) {
+    EGLint damage[4] = { x, y, width, height };
+    bufferAge = age;
+    surfaceDamage.begin(EGL_NO_DISPLAY, EGL_NO_SURFACE, damage, SURFACE_WIDTH, SURFACE_HEIGHT, redraw);
+}
+
+static void testAges() {
+    extensions = "EGL_KHR_partial_update";
+    queryFails = false;
+    SurfaceDamage surfaceDamage(FAKE_EGL);
+    surfaceDamage.initialize(EGL_NO_DISPLAY);
+    EGLint redraw[4];
+    regionCount = 0;
+    frame(surfaceDamage, 10, 10, 5, 5, 0, redraw);
+    check("unknown age redraws the surface", isRegion(redraw, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT)
+        && regionCount == 1 && isRegion(region, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT));
+    frame(surfaceDamage, 20, 30, 5, 5, 1, redraw);
+    check("age 1 redraws the frame damage", isRegion(redraw, 20, 30, 5, 5) && isRegion(region, 20, 30, 5, 5));
+    frame(surfaceDamage, 40, 50, 10, 10, 2, redraw);
+    check("age 2 adds the last frame", isRegion(redraw, 20, 30, 30, 30) && isRegion(region, 20, 30, 30, 30));
+    frame(surfaceDamage, 60, 70, 5, 5, 3, redraw);
+    check("age 3 adds two frames", isRegion(redraw, 20, 30, 45, 45) && isRegion(region, 20, 30, 45, 45));
+    frame(surfaceDamage, 0, 0, 1, 1, SURFACE_DAMAGE_HISTORY + 1, redraw);
+    check("age of the whole history adds every frame", isRegion(redraw, 0, 0, 65, 75));
+    frame(surfaceDamage, 5, 5, 1, 1, SURFACE_DAMAGE_HISTORY + 2, redraw);
+    check("age over the history redraws the surface", isRegion(redraw, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT)
+        && isRegion(region, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT));
+    queryFails = true;
+    frame(surfaceDamage, 5, 5, 1, 1, 1, redraw);
+    check("failed age query redraws the surface", isRegion(redraw, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT));
+    queryFails = false;
+    int count = regionCount;
+    frame(surfaceDamage, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT, 1, redraw);
+    check("whole damage sets no region", isRegion(redraw, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT) && regionCount == count);
+}
+
+static void testWithoutExtensions() {
+    extensions = "EGL_KHR_partial_update_other EGL_EXT_other";
+    SurfaceDamage surfaceDamage(FAKE_EGL);
+    surfaceDamage.initialize(EGL_NO_DISPLAY);
+    EGLint redraw[4];
+    regionCount = 0;
+    swapCount = 0;
+    frame(surfaceDamage, 10, 10, 5, 5, 1, redraw);
+    frame(surfaceDamage, 10, 10, 5, 5, 1, redraw);
+    check("no partial update redraws the surface", isRegion(redraw, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT) && regionCount == 0);
+    EGLint damage[4] = { 10, 10, 5, 5 };
+    surfaceDamage.swap(EGL_NO_DISPLAY, EGL_NO_SURFACE, damage);
+    check("no swap with damage swaps the surface", swapCount == 1);
+}
+
+// Swaps once with a damage rectangle on a display with the extensions.
+static void swapWith(const char* displayExtensions) {
+    extensions = displayExtensions;
+    SurfaceDamage surfaceDamage(FAKE_EGL);
+    surfaceDamage.initialize(EGL_NO_DISPLAY);
+    EGLint damage[4] = { 10, 20, 30, 40 };
+    swapCount = 0;
+    khrSwapCount = 0;
+    extSwapCount = 0;
+    swapDamageCount = 0;
+    memset(swapDamage, 0, sizeof(swapDamage));
+    surfaceDamage.swap(EGL_NO_DISPLAY, EGL_NO_SURFACE, damage);
+}
+
+static void testSwapWithDamage() {
+    swapWith("EGL_EXT_swap_buffers_with_damage EGL_KHR_swap_buffers_with_damage");
+    check("KHR swap gets the frame damage", khrSwapCount == 1 && extSwapCount == 0 && swapCount == 0
+        && swapDamageCount == 1 && isRegion(swapDamage, 10, 20, 30, 40));
+    swapWith("EGL_EXT_swap_buffers_with_damage");
+    check("EXT swap gets the frame damage", khrSwapCount == 0 && extSwapCount == 1 && swapCount == 0
+        && swapDamageCount == 1 && isRegion(swapDamage, 10, 20, 30, 40));
+    swapWith("EGL_KHR_swap_buffers_with_damage_other XEGL_EXT_swap_buffers_with_damage");
+    check("prefixed extension names are not matched", khrSwapCount == 0 && extSwapCount == 0 && swapCount == 1);
+}
+
+int main() {
+    testAges();
+    testWithoutExtensions();
+    testSwapWithDamage();
+    printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}